@@ -11,6 +11,8 @@
 #include <linux/blktrace_api.h>
 #include <linux/pr.h>
 #include <linux/uaccess.h>
+#include <linux/io_uring/cmd.h>
+#include <uapi/linux/blkdev.h>
 #include "blk.h"
 
 static int blkpg_do_ioctl(struct block_device *bdev,
@@ -692,3 +694,149 @@ long compat_blkdev_ioctl(struct file *file, unsigned cmd, unsigned long arg)
 	return ret;
 }
 #endif
+
+/*
+ * This overlays struct io_uring_cmd pdu.
+ */
+struct blk_iou_cmd {
+	int res;
+	/* range of a WRITE_ZEROES command, for the zero pages fallback */
+	sector_t sector;
+	sector_t nr_sects;
+};
+
+static inline struct blk_iou_cmd *blk_iou_cmd_pdu(struct io_uring_cmd *cmd)
+{
+	return (struct blk_iou_cmd *)&cmd->pdu;
+}
+
+static void blk_cmd_complete(struct io_uring_cmd *cmd, unsigned issue_flags)
+{
+	io_uring_cmd_done(cmd, blk_iou_cmd_pdu(cmd)->res, 0, issue_flags);
+}
+
+static void blk_cmd_bio_end_io(struct bio *bio);
+
+/*
+ * Like blkdev_issue_zeroout(), retry a failed WRITE ZEROES by writing zero
+ * pages: some devices only report that they don't support it when the
+ * command is issued.  Building the bio chain may sleep, so this runs from
+ * task context rather than from bio completion.
+ */
+static void blk_cmd_zeroout_fallback(struct io_uring_cmd *cmd,
+				     unsigned issue_flags)
+{
+	struct block_device *bdev = I_BDEV(cmd->file->f_mapping->host);
+	struct blk_iou_cmd *bic = blk_iou_cmd_pdu(cmd);
+	struct bio *bio = NULL;
+	int err;
+
+	err = __blkdev_issue_zero_pages(bdev, bic->sector, bic->nr_sects,
+					GFP_KERNEL, &bio);
+	if (err) {
+		bic->res = err;
+		blk_cmd_complete(cmd, issue_flags);
+		return;
+	}
+
+	bio->bi_private = cmd;
+	bio->bi_end_io = blk_cmd_bio_end_io;
+	submit_bio(bio);
+}
+
+static void blk_cmd_bio_end_io(struct bio *bio)
+{
+	struct io_uring_cmd *cmd = bio->bi_private;
+	int res = blk_status_to_errno(bio->bi_status);
+	enum req_op op = bio_op(bio);
+
+	bio_put(bio);
+	if (res && op == REQ_OP_WRITE_ZEROES) {
+		io_uring_cmd_complete_in_task(cmd, blk_cmd_zeroout_fallback);
+		return;
+	}
+	/* like blkdev_issue_discard(), a discard the device ignored is fine */
+	if (res == -EOPNOTSUPP && op == REQ_OP_DISCARD)
+		res = 0;
+	blk_iou_cmd_pdu(cmd)->res = res;
+	io_uring_cmd_complete_in_task(cmd, blk_cmd_complete);
+}
+
+static int blkdev_cmd_discard_zeroout(struct io_uring_cmd *cmd,
+				      struct block_device *bdev, u32 cmd_op,
+				      uint64_t start, uint64_t len)
+{
+	struct inode *inode = bdev->bd_inode;
+	blk_mode_t mode = file_to_blk_mode(cmd->file);
+	struct bio *bio = NULL;
+	uint64_t end;
+	int err;
+
+	if (!(mode & BLK_OPEN_WRITE))
+		return -EBADF;
+	if (cmd_op == BLOCK_URING_CMD_DISCARD &&
+	    !bdev_max_discard_sectors(bdev))
+		return -EOPNOTSUPP;
+
+	if ((start | len) & 511 || !len)
+		return -EINVAL;
+	if (check_add_overflow(start, len, &end) ||
+	    end > bdev_nr_bytes(bdev))
+		return -EINVAL;
+
+	filemap_invalidate_lock(inode->i_mapping);
+	err = truncate_bdev_range(bdev, mode, start, end - 1);
+	if (err)
+		goto fail;
+	if (cmd_op == BLOCK_URING_CMD_DISCARD) {
+		err = __blkdev_issue_discard(bdev, start >> 9, len >> 9,
+					     GFP_KERNEL, &bio);
+	} else {
+		blk_iou_cmd_pdu(cmd)->sector = start >> 9;
+		blk_iou_cmd_pdu(cmd)->nr_sects = len >> 9;
+		err = __blkdev_issue_zeroout(bdev, start >> 9, len >> 9,
+					     GFP_KERNEL, &bio,
+					     BLKDEV_ZERO_NOUNMAP);
+	}
+	if (err)
+		goto fail;
+
+	/* the last bio is the parent of the whole chain */
+	bio->bi_private = cmd;
+	bio->bi_end_io = blk_cmd_bio_end_io;
+	submit_bio(bio);
+	err = -EIOCBQUEUED;
+fail:
+	filemap_invalidate_unlock(inode->i_mapping);
+	return err;
+}
+
+/*
+ * Asynchronous counterparts of BLKDISCARD and BLKZEROOUT. Building the bio
+ * chain may sleep, so the nonblocking attempt is punted to io-wq, but the
+ * command completes from bio completion rather than waiting on the device.
+ */
+int blkdev_uring_cmd(struct io_uring_cmd *cmd, unsigned int issue_flags)
+{
+	struct block_device *bdev = I_BDEV(cmd->file->f_mapping->host);
+	const struct io_uring_sqe *sqe = cmd->sqe;
+	u32 cmd_op = cmd->cmd_op;
+
+	BUILD_BUG_ON(sizeof(struct blk_iou_cmd) > sizeof(cmd->pdu));
+
+	if (unlikely(sqe->ioprio || sqe->__pad1 || sqe->len ||
+		     sqe->rw_flags || sqe->file_index))
+		return -EINVAL;
+
+	switch (cmd_op) {
+	case BLOCK_URING_CMD_DISCARD:
+	case BLOCK_URING_CMD_WRITE_ZEROES:
+		if (issue_flags & IO_URING_F_NONBLOCK)
+			return -EAGAIN;
+		return blkdev_cmd_discard_zeroout(cmd, bdev, cmd_op,
+						  READ_ONCE(sqe->addr),
+						  READ_ONCE(sqe->addr3));
+	default:
+		return -EINVAL;
+	}
+}
@@ -5,6 +5,7 @@
  */
 #include <linux/ptrace.h>	/* for force_successful_syscall_return */
 #include <linux/nvme_ioctl.h>
+#include <linux/io_uring.h>
 #include <linux/io_uring/cmd.h>
 #include "nvme.h"
 
@@ -176,11 +177,14 @@ static int nvme_map_user_request(struct request *req, u64 ubuffer,
 	if (ioucmd && (ioucmd->flags & IORING_URING_CMD_FIXED)) {
 		struct iov_iter iter;
 
-		/* fixedbufs is only for non-vectored io */
-		if (WARN_ON_ONCE(flags & NVME_IOCTL_VEC))
-			return -EINVAL;
-		ret = io_uring_cmd_import_fixed(ubuffer, bufflen,
-				rq_data_dir(req), &iter, ioucmd);
+		/* for vectored io, bufflen is the number of iovecs */
+		if (flags & NVME_IOCTL_VEC)
+			ret = io_uring_cmd_import_fixed_vec(ioucmd,
+					nvme_to_user_ptr(ubuffer), bufflen,
+					rq_data_dir(req), &iter);
+		else
+			ret = io_uring_cmd_import_fixed(ubuffer, bufflen,
+					rq_data_dir(req), &iter, ioucmd);
 		if (ret < 0)
 			goto out;
 		ret = blk_rq_map_user_iov(q, req, NULL, &iter, GFP_KERNEL);
@@ -89,6 +89,8 @@ struct damon_target {
  * @DAMOS_NOHUGEPAGE:	Call ``madvise()`` for the region with MADV_NOHUGEPAGE.
  * @DAMOS_LRU_PRIO:	Prioritize the region on its LRU lists.
  * @DAMOS_LRU_DEPRIO:	Deprioritize the region on its LRU lists.
+ * @DAMOS_PROMOTE:	Migrate the region to the next faster memory tier.
+ * @DAMOS_DEMOTE:	Migrate the region to the next slower memory tier.
  * @DAMOS_STAT:		Do nothing but count the stat.
  * @NR_DAMOS_ACTIONS:	Total number of DAMOS actions
  */
@@ -100,6 +102,8 @@ enum damos_action {
 	DAMOS_NOHUGEPAGE,
 	DAMOS_LRU_PRIO,
 	DAMOS_LRU_DEPRIO,
+	DAMOS_PROMOTE,
+	DAMOS_DEMOTE,
 	DAMOS_STAT,		/* Do nothing but only record the stat */
 	NR_DAMOS_ACTIONS,
 };
@@ -274,6 +278,7 @@ struct damos_access_pattern {
  * @quota:		Control the aggressiveness of this scheme.
  * @wmarks:		Watermarks for automated (in)activation of this scheme.
  * @filters:		Additional set of &struct damos_filter for &action.
+ * @migrate_rate_limit:	Maximum MiB/s that &action may migrate, 0 for no limit.
  * @stat:		Statistics of this scheme.
  * @list:		List head for siblings.
  *
@@ -293,6 +298,10 @@ struct damos_access_pattern {
  * implementation could check pages of the region and skip &action to respect
  * &filters
  *
+ * For &DAMOS_PROMOTE and &DAMOS_DEMOTE, &migrate_rate_limit caps the
+ * migration bandwidth independently of &quota, so that promotion of a large
+ * hot region cannot saturate the interconnect to the slow memory tier.
+ *
  * After applying the &action to each region, &stat_count and &stat_sz is
  * updated to reflect the number of regions and total size of regions that the
  * &action is applied.
@@ -303,6 +312,12 @@ struct damos {
 	struct damos_quota quota;
 	struct damos_watermarks wmarks;
 	struct list_head filters;
+	unsigned long migrate_rate_limit;
+/* private: */
+	/* For charging the migration rate limit */
+	unsigned long migrate_window_start;
+	unsigned long migrate_window_sz;
+/* public: */
 	struct damos_stat stat;
 	struct list_head list;
 };
@@ -76,16 +76,71 @@ extern struct kobj_attribute shmem_enabled_attr;
 #define HPAGE_PUD_SIZE	((1UL) << HPAGE_PUD_SHIFT)
 #define HPAGE_PUD_MASK	(~(HPAGE_PUD_SIZE - 1))
 
+/*
+ * Mask of all large folio orders supported for anonymous THP; all orders up to
+ * and including HPAGE_PMD_ORDER, except order-0 (which is not "huge") and
+ * order-1 (which is a limitation of the THP implementation: the deferred
+ * split list lives in the third page of the folio).
+ */
+#define THP_ORDERS_ALL_ANON	((BIT(HPAGE_PMD_ORDER + 1) - 1) & ~(BIT(0) | BIT(1)))
+
 extern unsigned long transparent_hugepage_flags;
+extern unsigned long huge_anon_orders_always;
+extern unsigned long huge_anon_orders_madvise;
+extern unsigned long huge_anon_orders_inherit;
 
-#define hugepage_flags_enabled()					       \
+#define hugepage_global_enabled()				       \
 	(transparent_hugepage_flags &				       \
 	 ((1<<TRANSPARENT_HUGEPAGE_FLAG) |		       \
 	  (1<<TRANSPARENT_HUGEPAGE_REQ_MADV_FLAG)))
-#define hugepage_flags_always()				\
+#define hugepage_global_always()			\
 	(transparent_hugepage_flags &			\
 	 (1<<TRANSPARENT_HUGEPAGE_FLAG))
 
+static inline bool hugepage_flags_enabled(void)
+{
+	/*
+	 * We cover both the anon and the file-backed case here; file-backed
+	 * hugepages, when configured in, are determined by the global control.
+	 * Anon pmd-sized hugepages are determined by the pmd-size control.
+	 * Anon mTHP are determined by the per-size controls.
+	 */
+	return READ_ONCE(huge_anon_orders_always) ||
+	       READ_ONCE(huge_anon_orders_madvise) ||
+	       (READ_ONCE(huge_anon_orders_inherit) &&
+		hugepage_global_enabled());
+}
+
+static inline int highest_order(unsigned long orders)
+{
+	return fls_long(orders) - 1;
+}
+
+static inline int next_order(unsigned long *orders, int prev)
+{
+	*orders &= ~BIT(prev);
+	return highest_order(*orders);
+}
+
+/*
+ * Return the subset of @orders that the per-size sysfs controls allow for
+ * an anonymous mapping with @vm_flags.  "inherit" sizes follow the
+ * top-level transparent_hugepage/enabled setting.
+ */
+static inline unsigned long thp_anon_sysfs_orders(unsigned long vm_flags,
+						  unsigned long orders)
+{
+	unsigned long mask = READ_ONCE(huge_anon_orders_always);
+
+	if (vm_flags & VM_HUGEPAGE)
+		mask |= READ_ONCE(huge_anon_orders_madvise);
+	if (hugepage_global_always() ||
+	    ((vm_flags & VM_HUGEPAGE) && hugepage_global_enabled()))
+		mask |= READ_ONCE(huge_anon_orders_inherit);
+
+	return orders & mask;
+}
+
 /*
  * Do the below checks:
  *   - For file vma, check if the linear page offset of vma is
@@ -130,8 +185,40 @@ static inline bool file_thp_enabled(struct vm_area_struct *vma)
 	       !inode_is_open_for_write(inode) && S_ISREG(inode->i_mode);
 }
 
+/*
+ * Filter @orders down to those whose naturally aligned range around @addr
+ * lies entirely within @vma.
+ */
+static inline unsigned long thp_vma_suitable_orders(struct vm_area_struct *vma,
+		unsigned long addr, unsigned long orders)
+{
+	int order;
+
+	/*
+	 * Iterate over orders, highest to lowest, removing orders that don't
+	 * meet alignment requirements from the set. Exit loop at first order
+	 * that meets requirements, since all lower orders must also meet
+	 * requirements.
+	 */
+	order = highest_order(orders);
+
+	while (orders) {
+		unsigned long haddr = ALIGN_DOWN(addr, PAGE_SIZE << order);
+
+		if (haddr >= vma->vm_start &&
+		    haddr + (PAGE_SIZE << order) <= vma->vm_end)
+			break;
+		order = next_order(&orders, order);
+	}
+
+	return orders;
+}
+
 bool hugepage_vma_check(struct vm_area_struct *vma, unsigned long vm_flags,
 			bool smaps, bool in_pf, bool enforce_sysfs);
+unsigned long thp_vma_allowable_orders(struct vm_area_struct *vma,
+				       unsigned long vm_flags, bool in_pf,
+				       unsigned long orders);
 
 #define transparent_hugepage_use_zero_page()				\
 	(transparent_hugepage_flags &					\
@@ -282,6 +369,19 @@ static inline bool hugepage_vma_check(struct vm_area_struct *vma,
 	return false;
 }
 
+static inline unsigned long thp_vma_suitable_orders(struct vm_area_struct *vma,
+		unsigned long addr, unsigned long orders)
+{
+	return 0;
+}
+
+static inline unsigned long thp_vma_allowable_orders(struct vm_area_struct *vma,
+				unsigned long vm_flags, bool in_pf,
+				unsigned long orders)
+{
+	return 0;
+}
+
 static inline void prep_transhuge_page(struct page *page) {}
 
 #define transparent_hugepage_flags 0UL
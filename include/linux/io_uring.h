@@ -12,6 +12,10 @@ void __io_uring_free(struct task_struct *tsk);
 void io_uring_unreg_ringfd(void);
 const char *io_uring_get_opcode(u8 opcode);
 int io_uring_cmd_sock(struct io_uring_cmd *cmd, unsigned int issue_flags);
+int io_uring_cmd_import_fixed_vec(struct io_uring_cmd *ioucmd,
+				  const struct iovec __user *uvec,
+				  unsigned long uvec_segs, int ddir,
+				  struct iov_iter *iter);
 
 static inline void io_uring_files_cancel(void)
 {
@@ -50,6 +54,13 @@ static inline int io_uring_cmd_sock(struct io_uring_cmd *cmd,
 {
 	return -EOPNOTSUPP;
 }
+static inline int io_uring_cmd_import_fixed_vec(struct io_uring_cmd *ioucmd,
+				const struct iovec __user *uvec,
+				unsigned long uvec_segs, int ddir,
+				struct iov_iter *iter)
+{
+	return -EOPNOTSUPP;
+}
 static inline bool io_is_uring_fops(struct file *file)
 {
 	return false;
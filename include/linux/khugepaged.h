@@ -16,6 +16,7 @@ extern void khugepaged_enter_vma(struct vm_area_struct *vma,
 				 unsigned long vm_flags);
 extern void khugepaged_min_free_kbytes_update(void);
 extern bool current_is_khugepaged(void);
+extern void khugepaged_update_priority(struct mm_struct *mm);
 #ifdef CONFIG_SHMEM
 extern int collapse_pte_mapped_thp(struct mm_struct *mm, unsigned long addr,
 				   bool install_pmd);
@@ -59,6 +60,10 @@ static inline void khugepaged_min_free_kbytes_update(void)
 {
 }
 
+static inline void khugepaged_update_priority(struct mm_struct *mm)
+{
+}
+
 static inline bool current_is_khugepaged(void)
 {
 	return false;
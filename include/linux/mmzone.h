@@ -694,6 +694,18 @@ struct per_cpu_pages {
 #endif
 	short free_count;	/* consecutive free count */
 
+	/*
+	 * Adaptive tuning telemetry, protected by pcp->lock.  The nr_*
+	 * counters accumulate over one vmstat interval and are then moved
+	 * to the *_rate fields by decay_pcp_high().
+	 */
+	int nr_alloc;		/* pages allocated from the lists */
+	int nr_free;		/* pages freed to the lists */
+	int nr_contended;	/* zone->lock contended on refill/drain */
+	int alloc_rate;		/* nr_alloc of the last interval */
+	int free_rate;		/* nr_free of the last interval */
+	int contended_rate;	/* nr_contended of the last interval */
+
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[NR_PCP_LISTS];
 } ____cacheline_aligned_in_smp;
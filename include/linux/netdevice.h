@@ -3297,6 +3297,18 @@ struct softnet_data {
 	struct sk_buff_head	input_pkt_queue;
 	struct napi_struct	backlog;
 
+	/* Another possibly contended cache line, skbs freed by other cpus
+	 * and handed back to the cpu that allocated them.
+	 */
+	spinlock_t		defer_lock ____cacheline_aligned_in_smp;
+	int			defer_count;
+	int			defer_ipi_scheduled;
+	struct sk_buff		*defer_list;
+	call_single_data_t	defer_csd;
+
+	/* deferral stats, written by the owning cpu only */
+	unsigned int		defer_freed;
+	unsigned int		defer_full;
 };
 
 static inline void input_queue_head_incr(struct softnet_data *sd)
@@ -91,9 +91,12 @@ static inline int get_dumpable(struct mm_struct *mm)
 #define MMF_VM_MERGE_ANY	30
 #define MMF_VM_MERGE_ANY_MASK	(1 << MMF_VM_MERGE_ANY)
 
+#define MMF_THP_COLLAPSE_PRIO	31	/* khugepaged scans this mm first */
+#define MMF_THP_COLLAPSE_PRIO_MASK	(1UL << MMF_THP_COLLAPSE_PRIO)
+
 #define MMF_INIT_MASK		(MMF_DUMPABLE_MASK | MMF_DUMP_FILTER_MASK |\
 				 MMF_DISABLE_THP_MASK | MMF_HAS_MDWE_MASK |\
-				 MMF_VM_MERGE_ANY_MASK)
+				 MMF_VM_MERGE_ANY_MASK | MMF_THP_COLLAPSE_PRIO_MASK)
 
 static inline unsigned long mmf_init_flags(unsigned long flags)
 {
@@ -37,6 +37,7 @@
 #include <linux/in6.h>
 #include <linux/if_packet.h>
 #include <linux/llist.h>
+#include <linux/poison.h>
 #include <net/flow.h>
 #if IS_ENABLED(CONFIG_NF_CONNTRACK)
 #include <linux/netfilter/nf_conntrack_common.h>
@@ -753,6 +754,7 @@ typedef unsigned char *sk_buff_data_t;
  *		delivery_time at egress.
  *	@napi_id: id of the NAPI struct this skb came from
  *	@sender_cpu: (aka @napi_id) source CPU in XPS
+ *	@alloc_cpu: CPU which did the skb allocation.
  *	@secmark: security marking
  *	@mark: Generic packet mark
  *	@reserved_tailroom: (aka @mark) number of bytes of free space available
@@ -982,7 +984,8 @@ struct sk_buff {
 #ifdef __GENKSYMS__
 	char rh_reserved[RH_KABI_SKBUFF_RESERVED];
 #else
-	char rh_reserved[RH_KABI_SKBUFF_RESERVED];
+	char rh_reserved[RH_KABI_SKBUFF_RESERVED - 2];
+	u16 alloc_cpu;
 
 	/* RHEL kABI: add new fields that don't need to be copied by
 	 * __copy_skb_header here (just above rh_reserved_end), and
@@ -3198,6 +3201,7 @@ void napi_consume_skb(struct sk_buff *skb, int budget);
 
 void napi_skb_free_stolen_head(struct sk_buff *skb);
 void __napi_kfree_skb(struct sk_buff *skb, enum skb_drop_reason reason);
+void skb_attempt_defer_free(struct sk_buff *skb);
 
 /**
  * __dev_alloc_pages - allocate page for network Rx
@@ -3326,6 +3330,32 @@ static inline struct page *skb_frag_page(const skb_frag_t *frag)
 	return frag->bv_page;
 }
 
+bool __skb_pp_mp_page(struct page *page);
+
+/*
+ * Pages of a page_pool backed by a memory provider are only referenced
+ * through their pp_ref_count: the pool recycles them, and the provider
+ * reuses them, whatever their page refcount is.
+ */
+static inline bool skb_pp_mp_page(struct page *page)
+{
+#ifdef CONFIG_PAGE_POOL
+	return unlikely((compound_head(page)->pp_magic & ~0x3UL) ==
+			PP_SIGNATURE) && __skb_pp_mp_page(page);
+#else
+	return false;
+#endif
+}
+
+/* Reference a page an skb maps, to be dropped with skb_page_unref() */
+static inline void skb_page_ref(struct page *page)
+{
+	if (skb_pp_mp_page(page))
+		atomic_long_inc(&compound_head(page)->pp_ref_count);
+	else
+		get_page(page);
+}
+
 /**
  * __skb_frag_ref - take an addition reference on a paged fragment.
  * @frag: the paged fragment
@@ -3334,7 +3364,7 @@ static inline struct page *skb_frag_page(const skb_frag_t *frag)
  */
 static inline void __skb_frag_ref(skb_frag_t *frag)
 {
-	get_page(skb_frag_page(frag));
+	skb_page_ref(skb_frag_page(frag));
 }
 
 /**
@@ -3355,7 +3385,8 @@ static inline void
 skb_page_unref(const struct sk_buff *skb, struct page *page, bool napi_safe)
 {
 #ifdef CONFIG_PAGE_POOL
-	if (skb->pp_recycle && napi_pp_put_page(page, napi_safe))
+	if ((skb->pp_recycle || skb_pp_mp_page(page)) &&
+	    napi_pp_put_page(page, napi_safe))
 		return;
 #endif
 	put_page(page);
@@ -3367,7 +3398,8 @@ napi_frag_unref(skb_frag_t *frag, bool recycle, bool napi_safe)
 	struct page *page = skb_frag_page(frag);
 
 #ifdef CONFIG_PAGE_POOL
-	if (recycle && napi_pp_put_page(page, napi_safe))
+	if ((recycle || skb_pp_mp_page(page)) &&
+	    napi_pp_put_page(page, napi_safe))
 		return;
 #endif
 	put_page(page);
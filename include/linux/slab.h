@@ -140,6 +140,18 @@
 #define SLAB_SKIP_KFENCE	0
 #endif
 
+/*
+ * Keep a per-cpu array ("sheaf") of free objects in front of the slabs,
+ * refilled and flushed in bulk.  Meant for caches with high alloc/free
+ * churn such as objects freed through kfree_rcu().  Ignored by SLAB,
+ * SLUB_TINY and for caches with debugging enabled.
+ */
+#if defined(CONFIG_SLUB) && !defined(CONFIG_SLUB_TINY)
+#define SLAB_SHEAVES		((slab_flags_t __force)0x01000000U)
+#else
+#define SLAB_SHEAVES		0
+#endif
+
 /* The following flags affect the page allocator grouping pages by mobility */
 /* Objects are reclaimable */
 #ifndef CONFIG_SLUB_TINY
@@ -39,6 +39,12 @@ enum stat_item {
 	CPU_PARTIAL_FREE,	/* Refill cpu partial on free */
 	CPU_PARTIAL_NODE,	/* Refill cpu partial from node partial */
 	CPU_PARTIAL_DRAIN,	/* Drain cpu partial to node partial */
+	SHEAF_ALLOC,		/* Allocation served from the cpu sheaf */
+	SHEAF_ALLOC_MISS,	/* Allocation found the cpu sheaf empty */
+	SHEAF_FREE,		/* Object freed to the cpu sheaf */
+	SHEAF_FREE_BULK,	/* Several objects freed to the sheaf at once */
+	SHEAF_REFILL,		/* Sheaf refilled with a bulk allocation */
+	SHEAF_FLUSH,		/* Sheaf objects returned to their slabs */
 	NR_SLUB_STAT_ITEMS };
 
 #ifndef CONFIG_SLUB_TINY
@@ -58,6 +64,20 @@ struct kmem_cache_cpu {
 	unsigned stat[NR_SLUB_STAT_ITEMS];
 #endif
 };
+
+/*
+ * Per cpu array of free objects for caches created with SLAB_SHEAVES.
+ * Objects in a sheaf have already been through the free hooks, so they
+ * are handed out again without touching the slab freelists.
+ */
+#define SLUB_SHEAF_CAPACITY	32
+#define SLUB_SHEAF_BATCH	(SLUB_SHEAF_CAPACITY / 2)
+
+struct slub_sheaf {
+	local_lock_t lock;	/* Protects the fields below */
+	unsigned int size;	/* Number of objects in the sheaf */
+	void *objects[SLUB_SHEAF_CAPACITY];
+};
 #endif /* CONFIG_SLUB_TINY */
 
 #ifdef CONFIG_SLUB_CPU_PARTIAL
@@ -92,6 +112,7 @@ struct kmem_cache_order_objects {
 struct kmem_cache {
 #ifndef CONFIG_SLUB_TINY
 	struct kmem_cache_cpu __percpu *cpu_slab;
+	struct slub_sheaf __percpu *cpu_sheaves;	/* SLAB_SHEAVES only */
 #endif
 	/* Used for retrieving partial slabs, etc. */
 	slab_flags_t flags;
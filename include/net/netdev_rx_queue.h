@@ -7,6 +7,8 @@
 #include <linux/sysfs.h>
 #include <net/xdp.h>
 
+struct memory_provider_ops;
+
 /* This structure contains an instance of an RX queue. */
 struct netdev_rx_queue {
 	RH_KABI_EXCLUDE_WITH_SIZE(struct xdp_rxq_info xdp_rxq, RH_KABI_XDP_RXQ_MAX_LONGS)
@@ -26,8 +28,11 @@ struct netdev_rx_queue {
 	 */
 	struct napi_struct		*napi;
 
-	RH_KABI_RESERVE(1)
-	RH_KABI_RESERVE(2)
+	/* Memory provider backing page_pools created for this queue,
+	 * see net_mp_open_rxq().  Written under RTNL, read under RCU.
+	 */
+	RH_KABI_USE(1, const struct memory_provider_ops *mp_ops)
+	RH_KABI_USE(2, void *mp_priv)
 	RH_KABI_RESERVE(3)
 	RH_KABI_RESERVE(4)
 	RH_KABI_RESERVE(5)
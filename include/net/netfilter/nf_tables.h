@@ -1005,6 +1005,8 @@ static inline void nft_set_elem_update_expr(const struct nft_set_ext *ext,
 
 #define NFT_CHAIN_POLICY_UNSET		U8_MAX
 
+struct nft_chain_prog;
+
 /**
  *	struct nft_chain - nf_tables chain
  *
@@ -1016,10 +1018,14 @@ static inline void nft_set_elem_update_expr(const struct nft_set_ext *ext,
  *	@use: number of jump references to this chain
  *	@flags: bitmask of enum nft_chain_flags
  *	@name: name of the chain
+ *	@prog_gen_0: rules_gen_0 compiled for the packet path, or NULL
+ *	@prog_gen_1: rules_gen_1 compiled for the packet path, or NULL
  */
 struct nft_chain {
 	struct nft_rule			*__rcu *rules_gen_0;
 	struct nft_rule			*__rcu *rules_gen_1;
+	struct nft_chain_prog		__rcu *prog_gen_0;
+	struct nft_chain_prog		__rcu *prog_gen_1;
 	struct list_head		rules;
 	struct list_head		list;
 	struct rhlist_head		rhlhead;
@@ -1035,6 +1041,7 @@ struct nft_chain {
 
 	/* Only used during control plane commit phase: */
 	struct nft_rule			**rules_next;
+	struct nft_chain_prog		*prog_next;
 };
 
 int nft_chain_validate(const struct nft_ctx *ctx, const struct nft_chain *chain);
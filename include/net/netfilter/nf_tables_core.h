@@ -83,6 +83,9 @@ extern const struct nft_expr_ops nft_bitwise_fast_ops;
 extern struct static_key_false nft_counters_enabled;
 extern struct static_key_false nft_trace_enabled;
 
+struct nft_chain_prog *nft_chain_prog_build(struct nft_rule *const *rules);
+void nft_chain_prog_free(struct nft_chain_prog *prog);
+
 extern const struct nft_set_type nft_set_rhash_type;
 extern const struct nft_set_type nft_set_hash_type;
 extern const struct nft_set_type nft_set_hash_fast_type;
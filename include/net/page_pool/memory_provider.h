@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _NET_PAGE_POOL_MEMORY_PROVIDER_H
+#define _NET_PAGE_POOL_MEMORY_PROVIDER_H
+
+#include <linux/types.h>
+
+struct net_device;
+struct page;
+struct page_pool;
+
+/**
+ * struct memory_provider_ops - external backing memory for a page_pool
+ * @alloc_page:	hand an order-0 page to the pool, NULL if none is left.
+ *		Called from the pool's allocation context, usually NAPI.
+ * @release_page: take back a page the pool is done with.  The pool has
+ *		already DMA unmapped it and cleared its pp info.  The pool
+ *		takes no page references of its own on provider pages.
+ * @init:	a pool is being created on a queue bound to the provider.
+ *		Called under rcu_read_lock(), must not sleep.
+ * @destroy:	the pool is gone, all of its pages have been released.
+ *
+ * A provider is bound to an RX queue with net_mp_open_rxq(); page_pools the
+ * driver creates for that queue from then on take their pages from the
+ * provider instead of the page allocator.  Pools are matched to queues by
+ * their NAPI instance, see netif_queue_set_napi().
+ *
+ * The page refcount of provider pages is not used to decide whether the
+ * pool may recycle them.  A provider handing a page it received through an
+ * skb on to someone else takes a page->pp_ref_count reference for that, and
+ * drops it with page_pool_unref_page() and page_pool_put_unrefed_page()
+ * once the page comes back.
+ */
+struct memory_provider_ops {
+	struct page	*(*alloc_page)(struct page_pool *pool, gfp_t gfp);
+	void		(*release_page)(struct page_pool *pool, struct page *page);
+	int		(*init)(struct page_pool *pool);
+	void		(*destroy)(struct page_pool *pool);
+};
+
+int net_mp_open_rxq(struct net_device *dev, unsigned int rxq_idx,
+		    const struct memory_provider_ops *ops, void *priv);
+void net_mp_close_rxq(struct net_device *dev, unsigned int rxq_idx,
+		      void *priv);
+
+#endif /* _NET_PAGE_POOL_MEMORY_PROVIDER_H */
@@ -263,6 +263,40 @@ TRACE_EVENT(mm_page_pcpu_drain,
 		__entry->order, __entry->migratetype)
 );
 
+TRACE_EVENT(mm_pcp_tune,
+
+	TP_PROTO(struct zone *zone, struct per_cpu_pages *pcp),
+
+	TP_ARGS(zone, pcp),
+
+	TP_STRUCT__entry(
+		__field(	int,		nid		)
+		__field(	int,		zid		)
+		__field(	int,		cpu		)
+		__field(	int,		high		)
+		__field(	int,		batch		)
+		__field(	int,		alloc_rate	)
+		__field(	int,		free_rate	)
+		__field(	int,		contended	)
+	),
+
+	TP_fast_assign(
+		__entry->nid		= zone_to_nid(zone);
+		__entry->zid		= zone_idx(zone);
+		__entry->cpu		= smp_processor_id();
+		__entry->high		= pcp->high;
+		__entry->batch		= pcp->batch;
+		__entry->alloc_rate	= pcp->alloc_rate;
+		__entry->free_rate	= pcp->free_rate;
+		__entry->contended	= pcp->contended_rate;
+	),
+
+	TP_printk("nid=%d zid=%d cpu=%d high=%d batch=%d alloc_rate=%d free_rate=%d contended=%d",
+		__entry->nid, __entry->zid, __entry->cpu, __entry->high,
+		__entry->batch, __entry->alloc_rate, __entry->free_rate,
+		__entry->contended)
+);
+
 TRACE_EVENT(mm_page_alloc_extfrag,
 
 	TP_PROTO(struct page *page,
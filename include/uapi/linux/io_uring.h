@@ -86,6 +86,7 @@ struct io_uring_sqe {
 	union {
 		__s32	splice_fd_in;
 		__u32	file_index;
+		__u32	zcrx_ifq_idx;
 		__u32	optlen;
 		struct {
 			__u16	addr_len;
@@ -255,6 +256,11 @@ enum io_uring_op {
 	IORING_OP_FUTEX_WAKE,
 	IORING_OP_FUTEX_WAITV,
 	IORING_OP_FIXED_FD_INSTALL,
+	IORING_OP_RECV_ZC,
+	IORING_OP_READV_FIXED,
+	IORING_OP_WRITEV_FIXED,
+	IORING_OP_BIND,
+	IORING_OP_LISTEN,
 
 	/* this goes last, obviously */
 	IORING_OP_LAST,
@@ -350,11 +356,21 @@ enum io_uring_op {
  *				0 is reported if zerocopy was actually possible.
  *				IORING_NOTIF_USAGE_ZC_COPIED if data was copied
  *				(at least partially).
+ *
+ * IORING_RECVSEND_BUNDLE	Used with IOSQE_BUFFER_SELECT. If set, send or
+ *				recv will grab as many buffers from the buffer
+ *				group ID given and send them all, or fill as
+ *				many as it can with received data. The
+ *				completion result will be the number of bytes
+ *				transferred and IORING_CQE_F_BUFFER holds the
+ *				ID of the first buffer; the buffers used
+ *				follow it contiguously in the buffer ring.
  */
 #define IORING_RECVSEND_POLL_FIRST	(1U << 0)
 #define IORING_RECV_MULTISHOT		(1U << 1)
 #define IORING_RECVSEND_FIXED_BUF	(1U << 2)
 #define IORING_SEND_ZC_REPORT_USAGE	(1U << 3)
+#define IORING_RECVSEND_BUNDLE		(1U << 4)
 
 /*
  * cqe.res for IORING_CQE_F_NOTIF if
@@ -418,11 +434,20 @@ struct io_uring_cqe {
  * IORING_CQE_F_SOCK_NONEMPTY	If set, more data to read after socket recv
  * IORING_CQE_F_NOTIF	Set for notification CQEs. Can be used to distinct
  * 			them from sends.
+ * IORING_CQE_F_BUF_MORE	If set, the buffer ID set in the completion will
+ *			get more completions. The buffer is only partially
+ *			consumed and the kernel keeps using the rest of it,
+ *			it must not be reused until a completion for it
+ *			arrives without this flag. The data of each completion
+ *			starts where the previous one for the buffer ended.
+ *			Only set for buffer rings registered with
+ *			IOU_PBUF_RING_INC.
  */
 #define IORING_CQE_F_BUFFER		(1U << 0)
 #define IORING_CQE_F_MORE		(1U << 1)
 #define IORING_CQE_F_SOCK_NONEMPTY	(1U << 2)
 #define IORING_CQE_F_NOTIF		(1U << 3)
+#define IORING_CQE_F_BUF_MORE		(1U << 4)
 
 enum {
 	IORING_CQE_BUFFER_SHIFT		= 16,
@@ -434,6 +459,8 @@ enum {
 #define IORING_OFF_SQ_RING		0ULL
 #define IORING_OFF_CQ_RING		0x8000000ULL
 #define IORING_OFF_SQES			0x10000000ULL
+#define IORING_OFF_RQ_RING		0x20000000ULL
+#define IORING_OFF_ZCRX_AREA		0x30000000ULL
 #define IORING_OFF_PBUF_RING		0x80000000ULL
 #define IORING_OFF_PBUF_SHIFT		16
 #define IORING_OFF_MMAP_MASK		0xf8000000ULL
@@ -521,6 +548,8 @@ struct io_uring_params {
 #define IORING_FEAT_CQE_SKIP		(1U << 11)
 #define IORING_FEAT_LINKED_FILE		(1U << 12)
 #define IORING_FEAT_REG_REG_RING	(1U << 13)
+#define IORING_FEAT_RECVSEND_BUNDLE	(1U << 14)
+#define IORING_FEAT_MIN_TIMEOUT		(1U << 15)
 
 /*
  * io_uring_register(2) opcodes and arguments
@@ -570,6 +599,19 @@ enum {
 	/* return status information for a buffer group */
 	IORING_REGISTER_PBUF_STATUS		= 26,
 
+	/* set/clear busy poll settings */
+	IORING_REGISTER_NAPI			= 27,
+	IORING_UNREGISTER_NAPI			= 28,
+
+	/* resize the SQ/CQ rings, takes a struct io_uring_params */
+	IORING_REGISTER_RESIZE_RINGS		= 29,
+
+	/* register a zero copy receive interface queue */
+	IORING_REGISTER_ZCRX_IFQ		= 30,
+
+	/* clone registered buffers from source ring to current ring */
+	IORING_REGISTER_CLONE_BUFFERS		= 31,
+
 	/* this goes last */
 	IORING_REGISTER_LAST,
 
@@ -682,9 +724,17 @@ struct io_uring_buf_ring {
  *			mmap(2) with the offset set as:
  *			IORING_OFF_PBUF_RING | (bgid << IORING_OFF_PBUF_SHIFT)
  *			to get a virtual mapping for the ring.
+ * IOU_PBUF_RING_INC:	If set, buffers are consumed incrementally. Rather
+ *			than using a whole buffer per transfer, each transfer
+ *			only consumes as many bytes as it needs and the buffer
+ *			stays at the head of the ring until it is used up,
+ *			see IORING_CQE_F_BUF_MORE. The kernel updates addr and
+ *			len of the head entry as it goes, the application
+ *			tracks the offset into each buffer from the results.
  */
 enum {
 	IOU_PBUF_RING_MMAP	= 1,
+	IOU_PBUF_RING_INC	= 2,
 };
 
 /* argument for IORING_(UN)REGISTER_PBUF_RING */
@@ -703,6 +753,83 @@ struct io_uring_buf_status {
 	__u32	resv[8];
 };
 
+/* argument for IORING_(UN)REGISTER_NAPI */
+struct io_uring_napi {
+	__u32	busy_poll_to;
+	__u8	prefer_busy_poll;
+	__u8	pad[3];
+	__u64	resv;
+};
+
+/*
+ * Zero copy receive (IORING_OP_RECV_ZC).
+ *
+ * IORING_REGISTER_ZCRX_IFQ binds a NIC RX queue to a buffer area allocated
+ * by the kernel.  Page pools the driver creates for the queue from then on
+ * receive into the area, which the application maps with mmap(2) at
+ * IORING_OFF_ZCRX_AREA.  Each completion is a CQE32 whose second half is a
+ * struct io_uring_zcrx_cqe giving the offset of the data in the area; cqe.res
+ * is its length.  Once done with the data, the application hands the buffer
+ * back by putting the same offset into the refill ring, mapped at
+ * IORING_OFF_RQ_RING with the layout given in struct io_uring_zcrx_offsets.
+ */
+struct io_uring_zcrx_rqe {
+	__u64	off;
+	__u32	len;
+	__u32	__pad;
+};
+
+struct io_uring_zcrx_cqe {
+	__u64	off;
+	__u64	__pad;
+};
+
+/* The bit from which the area id is encoded into offsets */
+#define IORING_ZCRX_AREA_SHIFT	48
+#define IORING_ZCRX_AREA_MASK	(~(((__u64)1 << IORING_ZCRX_AREA_SHIFT) - 1))
+
+struct io_uring_zcrx_offsets {
+	__u32	head;
+	__u32	tail;
+	__u32	rqes;
+	__u32	__resv2;
+	__u64	__resv[2];
+};
+
+struct io_uring_zcrx_area_reg {
+	__u64	len;		/* area size, a multiple of the page size */
+	__u64	rq_area_token;	/* output: area id encoded as in offsets */
+	__u32	flags;
+	__u32	__resv1;
+	__u64	__resv2[2];
+};
+
+/* argument for IORING_REGISTER_ZCRX_IFQ */
+struct io_uring_zcrx_ifq_reg {
+	__u32	if_idx;
+	__u32	if_rxq;
+	__u32	rq_entries;
+	__u32	flags;
+
+	__u64	area_ptr;	/* pointer to struct io_uring_zcrx_area_reg */
+	__u64	__resv1;
+
+	struct io_uring_zcrx_offsets offsets;	/* output */
+	__u64	__resv[4];
+};
+
+/* src_fd is an index into the registered ring fds of the task */
+enum {
+	IORING_REGISTER_SRC_REGISTERED	= 1,
+};
+
+/* argument for IORING_REGISTER_CLONE_BUFFERS */
+struct io_uring_clone_buffers {
+	__u32	src_fd;
+	__u32	flags;
+	__u32	pad[6];
+};
+
 /*
  * io_uring_restriction->opcode values
  */
@@ -722,10 +849,16 @@ enum {
 	IORING_RESTRICTION_LAST
 };
 
+/*
+ * Argument for io_uring_enter(2) with IORING_ENTER_EXT_ARG. If
+ * min_wait_usec is set, waiting for min_complete events ends once that
+ * much time has passed and at least one event is available; with none
+ * available, it carries on until one is posted or ts expires.
+ */
 struct io_uring_getevents_arg {
 	__u64	sigmask;
 	__u32	sigmask_sz;
-	__u32	pad;
+	__u32	min_wait_usec;
 	__u64	ts;
 };
 
@@ -290,4 +290,13 @@ struct prctl_mm_map {
 
 #define PR_SET_MEMORY_MERGE		67
 #define PR_GET_MEMORY_MERGE		68
+
+/*
+ * khugepaged collapse priority of the calling process' mm.  Numbered well
+ * clear of the options allocated upstream after PR_GET_MEMORY_MERGE.
+ */
+#define PR_SET_THP_COLLAPSE_PRIORITY	0x4b480001
+#define PR_GET_THP_COLLAPSE_PRIORITY	0x4b480002
+# define PR_THP_COLLAPSE_PRIO_NORMAL	0
+# define PR_THP_COLLAPSE_PRIO_HIGH	1
 #endif /* _LINUX_PRCTL_H */
@@ -56,12 +56,12 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *f)
 {
 	struct io_ring_ctx *ctx = f->private_data;
 	struct io_overflow_cqe *ocqe;
-	struct io_rings *r = ctx->rings;
-	unsigned int sq_mask = ctx->sq_entries - 1, cq_mask = ctx->cq_entries - 1;
-	unsigned int sq_head = READ_ONCE(r->sq.head);
-	unsigned int sq_tail = READ_ONCE(r->sq.tail);
-	unsigned int cq_head = READ_ONCE(r->cq.head);
-	unsigned int cq_tail = READ_ONCE(r->cq.tail);
+	struct io_uring_sqe *sq_sqes;
+	unsigned int sq_mask, cq_mask;
+	unsigned int sq_head, sq_tail;
+	unsigned int cq_head, cq_tail;
+	struct io_rings *r;
+	u32 *sq_array;
 	unsigned int cq_shift = 0;
 	unsigned int sq_shift = 0;
 	unsigned int sq_entries, cq_entries;
@@ -74,6 +74,27 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *f)
 	if (ctx->flags & IORING_SETUP_SQE128)
 		sq_shift = 1;
 
+	/*
+	 * The rings may be resized concurrently: take a consistent snapshot
+	 * of them and of their sizes, RCU keeps the old ones around while we
+	 * print them.
+	 */
+	rcu_read_lock();
+	spin_lock(&ctx->completion_lock);
+	r = ctx->rings;
+	sq_sqes = ctx->sq_sqes;
+	sq_array = ctx->sq_array;
+	sq_entries = ctx->sq_entries;
+	cq_entries = ctx->cq_entries;
+	spin_unlock(&ctx->completion_lock);
+
+	sq_mask = sq_entries - 1;
+	cq_mask = cq_entries - 1;
+	sq_head = READ_ONCE(r->sq.head);
+	sq_tail = READ_ONCE(r->sq.tail);
+	cq_head = READ_ONCE(r->cq.head);
+	cq_tail = READ_ONCE(r->cq.tail);
+
 	/*
 	 * we may get imprecise sqe and cqe info if uring is actively running
 	 * since we get cached_sq_head and cached_cq_tail without uring_lock
@@ -89,7 +110,7 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *f)
 	seq_printf(m, "CqTail:\t%u\n", cq_tail);
 	seq_printf(m, "CachedCqTail:\t%u\n", ctx->cached_cq_tail);
 	seq_printf(m, "SQEs:\t%u\n", sq_tail - sq_head);
-	sq_entries = min(sq_tail - sq_head, ctx->sq_entries);
+	sq_entries = min(sq_tail - sq_head, sq_entries);
 	for (i = 0; i < sq_entries; i++) {
 		unsigned int entry = i + sq_head;
 		struct io_uring_sqe *sqe;
@@ -97,10 +118,10 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *f)
 
 		if (ctx->flags & IORING_SETUP_NO_SQARRAY)
 			break;
-		sq_idx = READ_ONCE(ctx->sq_array[entry & sq_mask]);
+		sq_idx = READ_ONCE(sq_array[entry & sq_mask]);
 		if (sq_idx > sq_mask)
 			continue;
-		sqe = &ctx->sq_sqes[sq_idx << sq_shift];
+		sqe = &sq_sqes[sq_idx << sq_shift];
 		seq_printf(m, "%5u: opcode:%s, fd:%d, flags:%x, off:%llu, "
 			      "addr:0x%llx, rw_flags:0x%x, buf_index:%d "
 			      "user_data:%llu",
@@ -122,7 +143,7 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *f)
 		seq_printf(m, "\n");
 	}
 	seq_printf(m, "CQEs:\t%u\n", cq_tail - cq_head);
-	cq_entries = min(cq_tail - cq_head, ctx->cq_entries);
+	cq_entries = min(cq_tail - cq_head, cq_entries);
 	for (i = 0; i < cq_entries; i++) {
 		unsigned int entry = i + cq_head;
 		struct io_uring_cqe *cqe = &r->cqes[(entry & cq_mask) << cq_shift];
@@ -135,6 +156,7 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *f)
 					cqe->big_cqe[0], cqe->big_cqe[1]);
 		seq_printf(m, "\n");
 	}
+	rcu_read_unlock();
 
 	/*
 	 * Avoid ABBA deadlock between the seq lock and the io_uring mutex,
@@ -211,5 +233,16 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *f)
 	}
 
 	spin_unlock(&ctx->completion_lock);
+
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	if (ctx->napi_enabled) {
+		seq_puts(m, "NAPI:\tenabled\n");
+		seq_printf(m, "napi_busy_poll_to:\t%u\n", ctx->napi_busy_poll_to);
+		seq_printf(m, "napi_prefer_busy_poll:\t%s\n",
+			   ctx->napi_prefer_busy_poll ? "true" : "false");
+	} else {
+		seq_puts(m, "NAPI:\tdisabled\n");
+	}
+#endif
 }
 #endif
@@ -101,6 +101,8 @@
 #include "poll.h"
 #include "rw.h"
 #include "alloc_cache.h"
+#include "napi.h"
+#include "zcrx.h"
 
 #define IORING_MAX_ENTRIES	32768
 #define IORING_MAX_CQ_ENTRIES	(2 * IORING_MAX_ENTRIES)
@@ -123,11 +125,6 @@
 #define IO_COMPL_BATCH			32
 #define IO_REQ_ALLOC_BATCH		8
 
-enum {
-	IO_CHECK_CQ_OVERFLOW_BIT,
-	IO_CHECK_CQ_DROPPED_BIT,
-};
-
 struct io_defer_entry {
 	struct list_head	list;
 	struct io_kiocb		*req;
@@ -194,7 +191,9 @@ static inline unsigned int __io_cqring_events(struct io_ring_ctx *ctx)
 
 static inline unsigned int __io_cqring_events_user(struct io_ring_ctx *ctx)
 {
-	return READ_ONCE(ctx->rings->cq.tail) - READ_ONCE(ctx->rings->cq.head);
+	struct io_rings *rings = READ_ONCE(ctx->rings);
+
+	return READ_ONCE(rings->cq.tail) - READ_ONCE(rings->cq.head);
 }
 
 static bool io_match_linked(struct io_kiocb *head)
@@ -351,6 +350,7 @@ static __cold struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	INIT_DELAYED_WORK(&ctx->fallback_work, io_fallback_req_func);
 	INIT_WQ_LIST(&ctx->submit_state.compl_reqs);
 	INIT_HLIST_HEAD(&ctx->cancelable_uring_cmd);
+	io_napi_init(ctx);
 	return ctx;
 err:
 	kfree(ctx->cancel_table.hbs);
@@ -580,7 +580,8 @@ static void io_eventfd_signal(struct io_ring_ctx *ctx)
 	 */
 	if (unlikely(!ev_fd))
 		goto out;
-	if (READ_ONCE(ctx->rings->cq_flags) & IORING_CQ_EVENTFD_DISABLED)
+	if (READ_ONCE(io_get_rings_rcu(ctx)->cq_flags) &
+	    IORING_CQ_EVENTFD_DISABLED)
 		goto out;
 	if (ev_fd->eventfd_async && !io_wq_current_is_worker())
 		goto out;
@@ -978,6 +979,35 @@ bool io_fill_cqe_req_aux(struct io_kiocb *req, bool defer, s32 res, u32 cflags)
 	return true;
 }
 
+/*
+ * Post an additional CQE32 for a multishot request, with @extra1 and @extra2
+ * in the big_cqe half.  Unlike io_post_aux_cqe() there's no overflow
+ * fallback, false is returned if the CQ ring is full.
+ */
+bool io_req_post_cqe32(struct io_kiocb *req, s32 res, u32 cflags,
+		       u64 extra1, u64 extra2)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_uring_cqe *cqe;
+	bool filled;
+
+	io_cq_lock(ctx);
+	ctx->cq_extra++;
+	filled = io_get_cqe(ctx, &cqe);
+	if (likely(filled)) {
+		trace_io_uring_complete(ctx, req, req->cqe.user_data, res,
+					cflags, extra1, extra2);
+
+		WRITE_ONCE(cqe->user_data, req->cqe.user_data);
+		WRITE_ONCE(cqe->res, res);
+		WRITE_ONCE(cqe->flags, cflags);
+		WRITE_ONCE(cqe->big_cqe[0], extra1);
+		WRITE_ONCE(cqe->big_cqe[1], extra2);
+	}
+	io_cq_unlock_post(ctx);
+	return filled;
+}
+
 static void __io_req_complete_post(struct io_kiocb *req, unsigned issue_flags)
 {
 	struct io_ring_ctx *ctx = req->ctx;
@@ -1051,7 +1081,7 @@ void io_req_defer_failed(struct io_kiocb *req, s32 res)
 	lockdep_assert_held(&req->ctx->uring_lock);
 
 	req_set_fail(req);
-	io_req_set_res(req, res, io_put_kbuf(req, IO_URING_F_UNLOCKED));
+	io_req_set_res(req, res, io_put_kbuf(req, res, IO_URING_F_UNLOCKED));
 	if (def->fail)
 		def->fail(req);
 	io_req_complete_defer(req);
@@ -1334,7 +1364,8 @@ static inline void io_req_local_work_add(struct io_kiocb *req, unsigned flags)
 
 	if (!head) {
 		if (ctx->flags & IORING_SETUP_TASKRUN_FLAG)
-			atomic_or(IORING_SQ_TASKRUN, &ctx->rings->sq_flags);
+			atomic_or(IORING_SQ_TASKRUN,
+				  &io_get_rings_rcu(ctx)->sq_flags);
 		if (ctx->has_evfd)
 			io_eventfd_signal(ctx);
 	}
@@ -2493,33 +2524,6 @@ int io_submit_sqes(struct io_ring_ctx *ctx, unsigned int nr)
 	return ret;
 }
 
-struct io_wait_queue {
-	struct wait_queue_entry wq;
-	struct io_ring_ctx *ctx;
-	unsigned cq_tail;
-	unsigned nr_timeouts;
-	ktime_t timeout;
-};
-
-static inline bool io_has_work(struct io_ring_ctx *ctx)
-{
-	return test_bit(IO_CHECK_CQ_OVERFLOW_BIT, &ctx->check_cq) ||
-	       !llist_empty(&ctx->work_llist);
-}
-
-static inline bool io_should_wake(struct io_wait_queue *iowq)
-{
-	struct io_ring_ctx *ctx = iowq->ctx;
-	int dist = READ_ONCE(ctx->rings->cq.tail) - (int) iowq->cq_tail;
-
-	/*
-	 * Wake up if we have enough events, or if a timeout occurred since we
-	 * started waiting. For timeouts, we always want to return to userspace,
-	 * regardless of event count.
-	 */
-	return dist >= 0 || atomic_read(&ctx->cq_timeouts) != iowq->nr_timeouts;
-}
-
 static int io_wake_function(struct wait_queue_entry *curr, unsigned int mode,
 			    int wake_flags, void *key)
 {
@@ -2557,6 +2561,26 @@ static bool current_pending_io(void)
 	return percpu_counter_read_positive(&tctx->inflight);
 }
 
+struct ext_arg {
+	size_t argsz;
+	struct __kernel_timespec __user *ts;
+	const sigset_t __user *sig;
+	u32 min_wait_usec;
+};
+
+/*
+ * The min wait time has passed. Whatever the application asked for, a
+ * single event is now enough to return, so lower the wait target; with
+ * events already available the caller sees it's done right away.
+ */
+static void io_cqring_min_timeout_expired(struct io_wait_queue *iowq)
+{
+	struct io_ring_ctx *ctx = iowq->ctx;
+
+	iowq->min_timeout = 0;
+	iowq->cq_tail = READ_ONCE(ctx->rings->cq.head) + 1;
+}
+
 /* when returns >0, the caller should retry */
 static inline int io_cqring_wait_schedule(struct io_ring_ctx *ctx,
 					  struct io_wait_queue *iowq)
@@ -2582,10 +2606,14 @@ static inline int io_cqring_wait_schedule(struct io_ring_ctx *ctx,
 	if (current_pending_io())
 		current->in_iowait = 1;
 	ret = 0;
-	if (iowq->timeout == KTIME_MAX)
+	if (iowq->min_timeout) {
+		if (!schedule_hrtimeout(&iowq->min_timeout, HRTIMER_MODE_ABS))
+			io_cqring_min_timeout_expired(iowq);
+	} else if (iowq->timeout == KTIME_MAX) {
 		schedule();
-	else if (!schedule_hrtimeout(&iowq->timeout, HRTIMER_MODE_ABS))
+	} else if (!schedule_hrtimeout(&iowq->timeout, HRTIMER_MODE_ABS)) {
 		ret = -ETIME;
+	}
 	current->in_iowait = 0;
 	return ret;
 }
@@ -2595,8 +2623,7 @@ static inline int io_cqring_wait_schedule(struct io_ring_ctx *ctx,
  * application must reap them itself, as they reside on the shared cq ring.
  */
 static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
-			  const sigset_t __user *sig, size_t sigsz,
-			  struct __kernel_timespec __user *uts)
+			  struct ext_arg *ext_arg)
 {
 	struct io_wait_queue iowq;
 	struct io_rings *rings = ctx->rings;
@@ -2619,28 +2646,41 @@ static int io_cqring_wait(struct io_ring_ctx *ctx, int min_events,
 	iowq.nr_timeouts = atomic_read(&ctx->cq_timeouts);
 	iowq.cq_tail = READ_ONCE(ctx->rings->cq.head) + min_events;
 	iowq.timeout = KTIME_MAX;
+	iowq.min_timeout = 0;
 
-	if (uts) {
+	if (ext_arg->ts) {
 		struct timespec64 ts;
 
-		if (get_timespec64(&ts, uts))
+		if (get_timespec64(&ts, ext_arg->ts))
 			return -EFAULT;
 		iowq.timeout = ktime_add_ns(timespec64_to_ktime(ts), ktime_get_ns());
 	}
 
-	if (sig) {
+	/* a min wait time only matters if it ends before the timeout */
+	if (ext_arg->min_wait_usec) {
+		iowq.min_timeout = ktime_add_us(ktime_get(),
+						ext_arg->min_wait_usec);
+		if (iowq.min_timeout >= iowq.timeout)
+			iowq.min_timeout = 0;
+	}
+
+	if (ext_arg->sig) {
+		const sigset_t __user *sig = ext_arg->sig;
+
 #ifdef CONFIG_COMPAT
 		if (in_compat_syscall())
 			ret = set_compat_user_sigmask((const compat_sigset_t __user *)sig,
-						      sigsz);
+						      ext_arg->argsz);
 		else
 #endif
-			ret = set_user_sigmask(sig, sigsz);
+			ret = set_user_sigmask(sig, ext_arg->argsz);
 
 		if (ret)
 			return ret;
 	}
 
+	io_napi_busy_loop(ctx, &iowq);
+
 	trace_io_uring_cqring_wait(ctx, min_events);
 	do {
 		int nr_wait = (int) iowq.cq_tail - READ_ONCE(ctx->rings->cq.tail);
@@ -2932,12 +2972,14 @@ static __cold void io_ring_ctx_free(struct io_ring_ctx *ctx)
 	}
 	io_rings_free(ctx);
 	io_kbuf_mmap_list_free(ctx);
+	io_unregister_zcrx_ifqs(ctx);
 
 	percpu_ref_exit(&ctx->refs);
 	free_uid(ctx->user);
 	io_req_caches_free(ctx);
 	if (ctx->hash_map)
 		io_wq_put_hash(ctx->hash_map);
+	io_napi_free(ctx);
 	kfree(ctx->cancel_table.hbs);
 	kfree(ctx->cancel_table_locked.hbs);
 	xa_destroy(&ctx->io_bl_xa);
@@ -2997,6 +3039,8 @@ static __poll_t io_uring_poll(struct file *file, poll_table *wait)
 	 * io_commit_cqring
 	 */
 	smp_rmb();
+	/* the rings may be resized under us, see io_get_rings_rcu() */
+	rcu_read_lock();
 	if (!io_sqring_full(ctx))
 		mask |= EPOLLOUT | EPOLLWRNORM;
 
@@ -3016,6 +3060,7 @@ static __poll_t io_uring_poll(struct file *file, poll_table *wait)
 
 	if (__io_cqring_events_user(ctx) || io_has_work(ctx))
 		mask |= EPOLLIN | EPOLLRDNORM;
+	rcu_read_unlock();
 
 	return mask;
 }
@@ -3467,6 +3512,15 @@ static void *io_uring_validate_mmap_request(struct file *file,
 		io_put_bl(ctx, bl);
 		break;
 		}
+	case IORING_OFF_RQ_RING: {
+		/* pairs with smp_store_release() in io_register_zcrx_ifq() */
+		struct io_zcrx_ifq *ifq = smp_load_acquire(&ctx->ifq);
+
+		if (!ifq || offset != IORING_OFF_RQ_RING)
+			return ERR_PTR(-EINVAL);
+		ptr = ifq->rq_ring;
+		break;
+		}
 	default:
 		return ERR_PTR(-EINVAL);
 	}
@@ -3483,9 +3537,14 @@ static void *io_uring_validate_mmap_request(struct file *file,
 static __cold int io_uring_mmap(struct file *file, struct vm_area_struct *vma)
 {
 	size_t sz = vma->vm_end - vma->vm_start;
+	loff_t offset = (loff_t)vma->vm_pgoff << PAGE_SHIFT;
 	unsigned long pfn;
 	void *ptr;
 
+	/* the zcrx area isn't contiguous, it's mapped page by page */
+	if ((offset & IORING_OFF_MMAP_MASK) == IORING_OFF_ZCRX_AREA)
+		return io_zcrx_mmap_area(file->private_data, vma);
+
 	ptr = io_uring_validate_mmap_request(file, vma->vm_pgoff, sz);
 	if (IS_ERR(ptr))
 		return PTR_ERR(ptr);
@@ -3508,6 +3567,11 @@ static unsigned long io_uring_mmu_get_unmapped_area(struct file *filp,
 	if (addr)
 		return -EINVAL;
 
+	/* backed by regular pages, no aliasing constraints */
+	if (((pgoff << PAGE_SHIFT) & IORING_OFF_MMAP_MASK) == IORING_OFF_ZCRX_AREA)
+		return current->mm->get_unmapped_area(NULL, 0, len, 0,
+						      flags | MAP_SHARED);
+
 	ptr = io_uring_validate_mmap_request(filp, pgoff, len);
 	if (IS_ERR(ptr))
 		return -ENOMEM;
@@ -3577,9 +3641,8 @@ static int io_validate_ext_arg(unsigned flags, const void __user *argp, size_t a
 	return 0;
 }
 
-static int io_get_ext_arg(unsigned flags, const void __user *argp, size_t *argsz,
-			  struct __kernel_timespec __user **ts,
-			  const sigset_t __user **sig)
+static int io_get_ext_arg(unsigned flags, const void __user *argp,
+			  struct ext_arg *ext_arg)
 {
 	struct io_uring_getevents_arg arg;
 
@@ -3588,24 +3651,24 @@ static int io_get_ext_arg(unsigned flags, const void __user *argp, size_t *argsz
 	 * is just a pointer to the sigset_t.
 	 */
 	if (!(flags & IORING_ENTER_EXT_ARG)) {
-		*sig = (const sigset_t __user *) argp;
-		*ts = NULL;
+		ext_arg->sig = (const sigset_t __user *) argp;
+		ext_arg->ts = NULL;
+		ext_arg->min_wait_usec = 0;
 		return 0;
 	}
 
 	/*
 	 * EXT_ARG is set - ensure we agree on the size of it and copy in our
-	 * timespec and sigset_t pointers if good.
+	 * timespec, sigset_t pointers and min wait time if good.
 	 */
-	if (*argsz != sizeof(arg))
+	if (ext_arg->argsz != sizeof(arg))
 		return -EINVAL;
 	if (copy_from_user(&arg, argp, sizeof(arg)))
 		return -EFAULT;
-	if (arg.pad)
-		return -EINVAL;
-	*sig = u64_to_user_ptr(arg.sigmask);
-	*argsz = arg.sigmask_sz;
-	*ts = u64_to_user_ptr(arg.ts);
+	ext_arg->sig = u64_to_user_ptr(arg.sigmask);
+	ext_arg->argsz = arg.sigmask_sz;
+	ext_arg->ts = u64_to_user_ptr(arg.ts);
+	ext_arg->min_wait_usec = arg.min_wait_usec;
 	return 0;
 }
 
@@ -3712,15 +3775,14 @@ SYSCALL_DEFINE6(io_uring_enter, unsigned int, fd, u32, to_submit,
 			}
 			mutex_unlock(&ctx->uring_lock);
 		} else {
-			const sigset_t __user *sig;
-			struct __kernel_timespec __user *ts;
+			struct ext_arg ext_arg = { .argsz = argsz };
 
-			ret2 = io_get_ext_arg(flags, argp, &argsz, &ts, &sig);
+			ret2 = io_get_ext_arg(flags, argp, &ext_arg);
 			if (likely(!ret2)) {
 				min_complete = min(min_complete,
 						   ctx->cq_entries);
-				ret2 = io_cqring_wait(ctx, min_complete, sig,
-						      argsz, ts);
+				ret2 = io_cqring_wait(ctx, min_complete,
+						      &ext_arg);
 			}
 		}
 
@@ -3817,37 +3879,8 @@ static __cold int io_allocate_scq_urings(struct io_ring_ctx *ctx,
 	return 0;
 }
 
-static int io_uring_install_fd(struct file *file)
-{
-	int fd;
-
-	fd = get_unused_fd_flags(O_RDWR | O_CLOEXEC);
-	if (fd < 0)
-		return fd;
-	fd_install(fd, file);
-	return fd;
-}
-
-/*
- * Allocate an anonymous fd, this is what constitutes the application
- * visible backing of an io_uring instance. The application mmaps this
- * fd to gain access to the SQ/CQ ring details.
- */
-static struct file *io_uring_get_file(struct io_ring_ctx *ctx)
-{
-	/* Create a new inode so that the LSM can block the creation.  */
-	return anon_inode_create_getfile("[io_uring]", &io_uring_fops, ctx,
-					 O_RDWR | O_CLOEXEC, NULL);
-}
-
-static __cold int io_uring_create(unsigned entries, struct io_uring_params *p,
-				  struct io_uring_params __user *params)
+static int io_uring_fill_params(unsigned entries, struct io_uring_params *p)
 {
-	struct io_ring_ctx *ctx;
-	struct io_uring_task *tctx;
-	struct file *file;
-	int ret;
-
 	if (!entries)
 		return -EINVAL;
 	if (entries > IORING_MAX_ENTRIES) {
@@ -3856,10 +3889,6 @@ static __cold int io_uring_create(unsigned entries, struct io_uring_params *p,
 		entries = IORING_MAX_ENTRIES;
 	}
 
-	if ((p->flags & IORING_SETUP_REGISTERED_FD_ONLY)
-	    && !(p->flags & IORING_SETUP_NO_MMAP))
-		return -EINVAL;
-
 	/*
 	 * Use twice as many entries for the CQ ring. It's possible for the
 	 * application to drive a higher depth than the size of the SQ ring,
@@ -3888,6 +3917,207 @@ static __cold int io_uring_create(unsigned entries, struct io_uring_params *p,
 	} else {
 		p->cq_entries = 2 * p->sq_entries;
 	}
+	return 0;
+}
+
+/*
+ * Resize the SQ and CQ rings, moving over the SQEs that haven't been
+ * submitted and the CQEs that haven't been reaped yet. @arg holds the new
+ * sizes as for io_uring_setup(), and the addresses of the new ring memory.
+ *
+ * Only supported for IORING_SETUP_NO_MMAP rings: kernel allocated rings
+ * are mapped into the application with remap_pfn_range(), so their pages
+ * can't be released while such a mapping may exist. The ring must also use
+ * IORING_SETUP_DEFER_TASKRUN, where only the submitter task, which is the
+ * one calling us with ->uring_lock held, posts CQEs and consumes SQEs.
+ */
+__cold int io_register_resize_rings(struct io_ring_ctx *ctx, void __user *arg)
+{
+	size_t sqe_size = sizeof(struct io_uring_sqe);
+	size_t cqe_size = sizeof(struct io_uring_cqe);
+	struct page **ring_pages = NULL, **sqe_pages = NULL;
+	unsigned short n_ring_pages, n_sqe_pages;
+	struct io_rings *o_rings = ctx->rings;
+	unsigned sq_head, sq_tail, cq_head, cq_tail, i;
+	size_t size, sq_array_offset;
+	struct io_uring_params p;
+	struct io_rings *rings;
+	u32 *sq_array = NULL;
+	u32 sq_flags;
+	void *sqes;
+	int ret;
+
+	if (!(ctx->flags & IORING_SETUP_NO_MMAP) ||
+	    !(ctx->flags & IORING_SETUP_DEFER_TASKRUN))
+		return -EINVAL;
+	if (copy_from_user(&p, arg, sizeof(p)))
+		return -EFAULT;
+	if (p.flags & ~(IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP))
+		return -EINVAL;
+	if (memchr_inv(p.resv, 0, sizeof(p.resv)))
+		return -EINVAL;
+	ret = io_uring_fill_params(p.sq_entries, &p);
+	if (ret)
+		return ret;
+
+	if (ctx->flags & IORING_SETUP_SQE128)
+		sqe_size *= 2;
+	if (ctx->flags & IORING_SETUP_CQE32)
+		cqe_size *= 2;
+
+	size = rings_size(ctx, p.sq_entries, p.cq_entries, &sq_array_offset);
+	if (size == SIZE_MAX)
+		return -EOVERFLOW;
+	rings = __io_uaddr_map(&ring_pages, &n_ring_pages, p.cq_off.user_addr,
+			       size);
+	if (IS_ERR(rings))
+		return PTR_ERR(rings);
+
+	size = array_size(sqe_size, p.sq_entries);
+	if (size == SIZE_MAX) {
+		ret = -EOVERFLOW;
+		goto out_free_rings;
+	}
+	sqes = __io_uaddr_map(&sqe_pages, &n_sqe_pages, p.sq_off.user_addr,
+			      size);
+	if (IS_ERR(sqes)) {
+		ret = PTR_ERR(sqes);
+		goto out_free_rings;
+	}
+
+	if (!(ctx->flags & IORING_SETUP_NO_SQARRAY)) {
+		sq_array = (u32 *)((char *)rings + sq_array_offset);
+		p.sq_off.array = sq_array_offset;
+	}
+	if (copy_to_user(arg, &p, sizeof(p))) {
+		ret = -EFAULT;
+		goto out_free_sqes;
+	}
+
+	/* overflow posting may come from elsewhere, keep it out */
+	spin_lock(&ctx->completion_lock);
+	sq_head = ctx->cached_sq_head;
+	sq_tail = READ_ONCE(o_rings->sq.tail);
+	cq_head = READ_ONCE(o_rings->cq.head);
+	cq_tail = ctx->cached_cq_tail;
+	if (sq_tail - sq_head > p.sq_entries ||
+	    cq_tail - cq_head > p.cq_entries) {
+		spin_unlock(&ctx->completion_lock);
+		ret = -EOVERFLOW;
+		goto out_free_sqes;
+	}
+
+	for (i = sq_head; i != sq_tail; i++) {
+		unsigned src = i & (ctx->sq_entries - 1);
+		unsigned dst = i & (p.sq_entries - 1);
+
+		if (sq_array) {
+			/* keep invalid indices invalid, they'll get dropped */
+			src = READ_ONCE(ctx->sq_array[src]);
+			if (src >= ctx->sq_entries) {
+				sq_array[dst] = p.sq_entries;
+				continue;
+			}
+			sq_array[dst] = dst;
+		}
+		memcpy(sqes + dst * sqe_size,
+		       (void *)ctx->sq_sqes + src * sqe_size, sqe_size);
+	}
+
+	for (i = cq_head; i != cq_tail; i++) {
+		unsigned src = i & (ctx->cq_entries - 1);
+		unsigned dst = i & (p.cq_entries - 1);
+
+		memcpy((void *)rings->cqes + dst * cqe_size,
+		       (void *)o_rings->cqes + src * cqe_size, cqe_size);
+	}
+
+	WRITE_ONCE(rings->sq.head, sq_head);
+	WRITE_ONCE(rings->sq.tail, sq_tail);
+	WRITE_ONCE(rings->cq.head, cq_head);
+	WRITE_ONCE(rings->cq.tail, cq_tail);
+	rings->sq_ring_mask = p.sq_entries - 1;
+	rings->cq_ring_mask = p.cq_entries - 1;
+	rings->sq_ring_entries = p.sq_entries;
+	rings->cq_ring_entries = p.cq_entries;
+	sq_flags = atomic_read(&o_rings->sq_flags);
+	atomic_set(&rings->sq_flags, sq_flags);
+	WRITE_ONCE(rings->sq_dropped, READ_ONCE(o_rings->sq_dropped));
+	WRITE_ONCE(rings->cq_flags, READ_ONCE(o_rings->cq_flags));
+	WRITE_ONCE(rings->cq_overflow, READ_ONCE(o_rings->cq_overflow));
+
+	/* pairs with io_get_rings_rcu(), the new rings must be seen filled */
+	smp_store_release(&ctx->rings, rings);
+	ctx->sq_sqes = sqes;
+	ctx->sq_array = sq_array;
+	ctx->sq_entries = p.sq_entries;
+	ctx->cq_entries = p.cq_entries;
+	/* the cached CQE range points into the old ring */
+	ctx->cqe_cached = ctx->cqe_sentinel = NULL;
+
+	/* hand the old pages to the cleanup below */
+	swap(ctx->ring_pages, ring_pages);
+	swap(ctx->n_ring_pages, n_ring_pages);
+	swap(ctx->sqe_pages, sqe_pages);
+	swap(ctx->n_sqe_pages, n_sqe_pages);
+	spin_unlock(&ctx->completion_lock);
+
+	/*
+	 * Lockless users, like task_work adds setting IORING_SQ_TASKRUN, may
+	 * still be looking at the old rings.  Wait for them before freeing,
+	 * then carry over any sq flag they set on the old rings after the copy.
+	 */
+	synchronize_rcu();
+	sq_flags = atomic_read(&o_rings->sq_flags) & ~sq_flags;
+	if (sq_flags)
+		atomic_or(sq_flags, &rings->sq_flags);
+	ret = 0;
+
+out_free_sqes:
+	io_pages_free(&sqe_pages, n_sqe_pages);
+out_free_rings:
+	io_pages_free(&ring_pages, n_ring_pages);
+	return ret;
+}
+
+static int io_uring_install_fd(struct file *file)
+{
+	int fd;
+
+	fd = get_unused_fd_flags(O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+		return fd;
+	fd_install(fd, file);
+	return fd;
+}
+
+/*
+ * Allocate an anonymous fd, this is what constitutes the application
+ * visible backing of an io_uring instance. The application mmaps this
+ * fd to gain access to the SQ/CQ ring details.
+ */
+static struct file *io_uring_get_file(struct io_ring_ctx *ctx)
+{
+	/* Create a new inode so that the LSM can block the creation.  */
+	return anon_inode_create_getfile("[io_uring]", &io_uring_fops, ctx,
+					 O_RDWR | O_CLOEXEC, NULL);
+}
+
+static __cold int io_uring_create(unsigned entries, struct io_uring_params *p,
+				  struct io_uring_params __user *params)
+{
+	struct io_ring_ctx *ctx;
+	struct io_uring_task *tctx;
+	struct file *file;
+	int ret;
+
+	if ((p->flags & IORING_SETUP_REGISTERED_FD_ONLY)
+	    && !(p->flags & IORING_SETUP_NO_MMAP))
+		return -EINVAL;
+
+	ret = io_uring_fill_params(entries, p);
+	if (ret)
+		return ret;
 
 	ctx = io_ring_ctx_alloc(p);
 	if (!ctx)
@@ -4003,7 +4233,8 @@ static __cold int io_uring_create(unsigned entries, struct io_uring_params *p,
 			IORING_FEAT_POLL_32BITS | IORING_FEAT_SQPOLL_NONFIXED |
 			IORING_FEAT_EXT_ARG | IORING_FEAT_NATIVE_WORKERS |
 			IORING_FEAT_RSRC_TAGS | IORING_FEAT_CQE_SKIP |
-			IORING_FEAT_LINKED_FILE | IORING_FEAT_REG_REG_RING;
+			IORING_FEAT_LINKED_FILE | IORING_FEAT_REG_REG_RING |
+			IORING_FEAT_RECVSEND_BUNDLE | IORING_FEAT_MIN_TIMEOUT;
 
 	if (copy_to_user(params, p, sizeof(*p))) {
 		ret = -EFAULT;
@@ -4163,6 +4394,7 @@ static int __init io_uring_init(void)
 	BUILD_BUG_SQE_ELEM(42, __u16,  personality);
 	BUILD_BUG_SQE_ELEM(44, __s32,  splice_fd_in);
 	BUILD_BUG_SQE_ELEM(44, __u32,  file_index);
+	BUILD_BUG_SQE_ELEM(44, __u32,  zcrx_ifq_idx);
 	BUILD_BUG_SQE_ELEM(44, __u16,  addr_len);
 	BUILD_BUG_SQE_ELEM(46, __u16,  __pad3[0]);
 	BUILD_BUG_SQE_ELEM(48, __u64,  addr3);
@@ -35,6 +35,45 @@ enum {
 	IOU_STOP_MULTISHOT	= -ECANCELED,
 };
 
+enum {
+	IO_CHECK_CQ_OVERFLOW_BIT,
+	IO_CHECK_CQ_DROPPED_BIT,
+};
+
+struct io_wait_queue {
+	struct wait_queue_entry wq;
+	struct io_ring_ctx *ctx;
+	unsigned cq_tail;
+	unsigned nr_timeouts;
+	ktime_t timeout;
+	/* 0 if there's no min wait time, or once it has expired */
+	ktime_t min_timeout;
+
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	unsigned int napi_busy_poll_to;
+	bool napi_prefer_busy_poll;
+#endif
+};
+
+static inline bool io_should_wake(struct io_wait_queue *iowq)
+{
+	struct io_ring_ctx *ctx = iowq->ctx;
+	int dist = READ_ONCE(ctx->rings->cq.tail) - (int) iowq->cq_tail;
+
+	/*
+	 * Wake up if we have enough events, or if a timeout occurred since we
+	 * started waiting. For timeouts, we always want to return to userspace,
+	 * regardless of event count.
+	 */
+	return dist >= 0 || atomic_read(&ctx->cq_timeouts) != iowq->nr_timeouts;
+}
+
+static inline bool io_has_work(struct io_ring_ctx *ctx)
+{
+	return test_bit(IO_CHECK_CQ_OVERFLOW_BIT, &ctx->check_cq) ||
+	       !llist_empty(&ctx->work_llist);
+}
+
 bool io_cqe_cache_refill(struct io_ring_ctx *ctx, bool overflow);
 void io_req_cqe_overflow(struct io_kiocb *req);
 int io_run_task_work_sig(struct io_ring_ctx *ctx);
@@ -42,6 +81,8 @@ void io_req_defer_failed(struct io_kiocb *req, s32 res);
 void io_req_complete_post(struct io_kiocb *req, unsigned issue_flags);
 bool io_post_aux_cqe(struct io_ring_ctx *ctx, u64 user_data, s32 res, u32 cflags);
 bool io_fill_cqe_req_aux(struct io_kiocb *req, bool defer, s32 res, u32 cflags);
+bool io_req_post_cqe32(struct io_kiocb *req, s32 res, u32 cflags,
+		       u64 extra1, u64 extra2);
 void __io_commit_cqring_flush(struct io_ring_ctx *ctx);
 
 struct page **io_pin_pages(unsigned long ubuf, unsigned long len, int *npages);
@@ -84,6 +125,7 @@ bool io_match_task_safe(struct io_kiocb *head, struct task_struct *task,
 
 void *io_mem_alloc(size_t size);
 void io_mem_free(void *ptr);
+int io_register_resize_rings(struct io_ring_ctx *ctx, void __user *arg);
 
 enum {
 	IO_EVENTFD_OP_SIGNAL_BIT,
@@ -256,9 +298,21 @@ static inline void io_cqring_wake(struct io_ring_ctx *ctx)
 				poll_to_key(EPOLL_URING_WAKE | EPOLLIN));
 }
 
+/*
+ * IORING_REGISTER_RESIZE_RINGS replaces ->rings under ->uring_lock and
+ * ->completion_lock, and frees the old rings after an RCU grace period.
+ * Accesses not serialised by either lock must be inside rcu_read_lock().
+ */
+static inline struct io_rings *io_get_rings_rcu(struct io_ring_ctx *ctx)
+{
+	RCU_LOCKDEP_WARN(!rcu_read_lock_held(),
+			 "io_uring rings accessed without RCU protection");
+	return READ_ONCE(ctx->rings);
+}
+
 static inline bool io_sqring_full(struct io_ring_ctx *ctx)
 {
-	struct io_rings *r = ctx->rings;
+	struct io_rings *r = READ_ONCE(ctx->rings);
 
 	return READ_ONCE(r->sq.tail) - ctx->cached_sq_head == ctx->sq_entries;
 }
@@ -92,7 +92,8 @@ bool io_kbuf_recycle_legacy(struct io_kiocb *req, unsigned issue_flags)
 	return true;
 }
 
-unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags)
+unsigned int __io_put_kbuf(struct io_kiocb *req, int len, int nbufs,
+			   unsigned issue_flags)
 {
 	unsigned int cflags;
 
@@ -110,17 +111,19 @@ unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags)
 	 */
 	if (req->flags & REQ_F_BUFFER_RING) {
 		/* no buffers to recycle for this case */
-		cflags = __io_put_kbuf_list(req, NULL);
+		cflags = __io_put_kbuf_list(req, len, nbufs, NULL);
 	} else if (issue_flags & IO_URING_F_UNLOCKED) {
 		struct io_ring_ctx *ctx = req->ctx;
 
 		spin_lock(&ctx->completion_lock);
-		cflags = __io_put_kbuf_list(req, &ctx->io_buffers_comp);
+		cflags = __io_put_kbuf_list(req, len, nbufs,
+					    &ctx->io_buffers_comp);
 		spin_unlock(&ctx->completion_lock);
 	} else {
 		lockdep_assert_held(&req->ctx->uring_lock);
 
-		cflags = __io_put_kbuf_list(req, &req->ctx->io_buffers_cache);
+		cflags = __io_put_kbuf_list(req, len, nbufs,
+					    &req->ctx->io_buffers_cache);
 	}
 	return cflags;
 }
@@ -143,6 +146,64 @@ static void __user *io_provided_buffer_select(struct io_kiocb *req, size_t *len,
 	return NULL;
 }
 
+static struct io_uring_buf *io_ring_head_to_buf(struct io_buffer_list *bl,
+						__u16 head)
+{
+	head &= bl->mask;
+	/* mmaped buffers are always contig */
+	if (bl->is_mmap || head < IO_BUFFER_LIST_BUF_PER_PAGE) {
+		return &bl->buf_ring->bufs[head];
+	} else {
+		int off = head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1);
+		int index = head / IO_BUFFER_LIST_BUF_PER_PAGE;
+		struct io_uring_buf *buf = page_address(bl->buf_pages[index]);
+
+		return buf + off;
+	}
+}
+
+static bool io_kbuf_inc_commit(struct io_buffer_list *bl, int len)
+{
+	/*
+	 * Nothing transferred, e.g. an error or EOF: the head buffer is left
+	 * untouched and there is no partially consumed buffer to report.
+	 */
+	if (len <= 0)
+		return true;
+
+	while (len) {
+		struct io_uring_buf *buf = io_ring_head_to_buf(bl, bl->head);
+		u32 buf_len = READ_ONCE(buf->len);
+		u32 this_len = min_t(u32, len, buf_len);
+
+		buf_len -= this_len;
+		/* stop at a zero sized buffer rather than walking past it */
+		if (buf_len || !this_len) {
+			WRITE_ONCE(buf->addr, READ_ONCE(buf->addr) + this_len);
+			WRITE_ONCE(buf->len, buf_len);
+			return false;
+		}
+		WRITE_ONCE(buf->len, 0);
+		bl->head++;
+		len -= this_len;
+	}
+	return true;
+}
+
+/*
+ * Consume @nr buffers from the head of the ring, or @len bytes worth of
+ * them if the ring is incrementally consumed. Returns false if data went
+ * into the last buffer used and it has room left, so it stays at the head
+ * of the ring.
+ */
+bool io_kbuf_commit(struct io_buffer_list *bl, int len, int nr)
+{
+	if (bl->is_inc)
+		return io_kbuf_inc_commit(bl, len);
+	bl->head += nr;
+	return true;
+}
+
 static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 					  struct io_buffer_list *bl,
 					  unsigned int issue_flags)
@@ -150,22 +211,15 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 	struct io_uring_buf_ring *br = bl->buf_ring;
 	struct io_uring_buf *buf;
 	__u16 head = bl->head;
+	__u64 addr;
 
 	if (unlikely(smp_load_acquire(&br->tail) == head))
 		return NULL;
 
-	head &= bl->mask;
-	/* mmaped buffers are always contig */
-	if (bl->is_mmap || head < IO_BUFFER_LIST_BUF_PER_PAGE) {
-		buf = &br->bufs[head];
-	} else {
-		int off = head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1);
-		int index = head / IO_BUFFER_LIST_BUF_PER_PAGE;
-		buf = page_address(bl->buf_pages[index]);
-		buf += off;
-	}
+	buf = io_ring_head_to_buf(bl, head);
 	if (*len == 0 || *len > buf->len)
 		*len = buf->len;
+	addr = READ_ONCE(buf->addr);
 	req->flags |= REQ_F_BUFFER_RING;
 	req->buf_list = bl;
 	req->buf_index = buf->bid;
@@ -179,12 +233,14 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 		 * io-wq context and there may be further retries in async hybrid
 		 * mode. For the locked case, the caller must call commit when
 		 * the transfer completes (or if we get -EAGAIN and must poll of
-		 * retry).
+		 * retry). An incrementally consumed buffer only gives up what
+		 * was asked for.
 		 */
 		req->buf_list = NULL;
-		bl->head++;
+		if (!io_kbuf_commit(bl, *len, 1))
+			req->flags |= REQ_F_BUF_MORE;
 	}
-	return u64_to_user_ptr(buf->addr);
+	return u64_to_user_ptr(addr);
 }
 
 void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
@@ -207,6 +263,107 @@ void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 	return ret;
 }
 
+static int io_ring_buffers_peek(struct io_kiocb *req, struct buf_sel_arg *arg,
+				struct io_buffer_list *bl,
+				unsigned int issue_flags)
+{
+	struct io_uring_buf_ring *br = bl->buf_ring;
+	size_t left = arg->max_len;
+	int nr_iovs = arg->nr_iovs;
+	struct io_uring_buf *buf;
+	__u16 head = bl->head;
+	bool commit = false;
+	int nr = 0;
+
+	nr_iovs = min_t(__u16, smp_load_acquire(&br->tail) - head, nr_iovs);
+	if (unlikely(!nr_iovs))
+		return -ENOBUFS;
+
+	/*
+	 * Coming in unlocked, the buffers have to be consumed right away,
+	 * see io_ring_buffer_select(), and we can't know yet how many of
+	 * them the transfer will end up using. Stick to a single buffer for
+	 * that case.
+	 */
+	if (issue_flags & IO_URING_F_UNLOCKED || !io_file_can_poll(req)) {
+		nr_iovs = 1;
+		commit = true;
+	}
+
+	buf = io_ring_head_to_buf(bl, head);
+	req->buf_index = buf->bid;
+	arg->out_len = 0;
+	do {
+		u32 len = READ_ONCE(buf->len);
+
+		if (!len)
+			break;
+		if (arg->max_len) {
+			if (len > left)
+				len = left;
+			left -= len;
+		}
+		arg->iovs[nr].iov_base = u64_to_user_ptr(READ_ONCE(buf->addr));
+		arg->iovs[nr].iov_len = len;
+		arg->out_len += len;
+		nr++;
+		if (arg->max_len && !left)
+			break;
+		buf = io_ring_head_to_buf(bl, ++head);
+	} while (nr < nr_iovs);
+
+	if (unlikely(!nr))
+		return -ENOBUFS;
+
+	req->flags |= REQ_F_BUFFER_RING;
+	req->buf_list = bl;
+	if (commit) {
+		req->buf_list = NULL;
+		if (!io_kbuf_commit(bl, arg->out_len, 1))
+			req->flags |= REQ_F_BUF_MORE;
+	}
+	return nr;
+}
+
+/*
+ * Select up to @arg->nr_iovs buffers from the group, starting at the head
+ * of the buffer ring, and map them into @arg->iovs. Classic provided
+ * buffers only ever yield a single buffer. Returns the number of iovecs
+ * filled in, or a negative error. The buffers are put, and for the ring
+ * committed, by io_put_kbufs() once the number actually used is known.
+ */
+int io_buffers_select(struct io_kiocb *req, struct buf_sel_arg *arg,
+		      unsigned int issue_flags)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_buffer_list *bl;
+	int ret = -ENOBUFS;
+
+	io_ring_submit_lock(ctx, issue_flags);
+
+	bl = io_buffer_get_list(ctx, req->buf_index);
+	if (unlikely(!bl))
+		goto out_unlock;
+
+	if (bl->is_mapped) {
+		ret = io_ring_buffers_peek(req, arg, bl, issue_flags);
+	} else {
+		size_t len = arg->max_len;
+		void __user *buf;
+
+		buf = io_provided_buffer_select(req, &len, bl);
+		if (buf) {
+			arg->iovs[0].iov_base = buf;
+			arg->iovs[0].iov_len = len;
+			arg->out_len = len;
+			ret = 1;
+		}
+	}
+out_unlock:
+	io_ring_submit_unlock(ctx, issue_flags);
+	return ret;
+}
+
 /*
  * Mark the given mapped range as free for reuse
  */
@@ -630,7 +787,7 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 
 	if (reg.resv[0] || reg.resv[1] || reg.resv[2])
 		return -EINVAL;
-	if (reg.flags & ~IOU_PBUF_RING_MMAP)
+	if (reg.flags & ~(IOU_PBUF_RING_MMAP | IOU_PBUF_RING_INC))
 		return -EINVAL;
 	if (!(reg.flags & IOU_PBUF_RING_MMAP)) {
 		if (!reg.ring_addr)
@@ -668,6 +825,7 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 	if (!ret) {
 		bl->nr_entries = reg.ring_entries;
 		bl->mask = reg.ring_entries - 1;
+		bl->is_inc = !!(reg.flags & IOU_PBUF_RING_INC);
 
 		io_buffer_add_list(ctx, bl, reg.bgid);
 		return 0;
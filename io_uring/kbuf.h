@@ -31,6 +31,8 @@ struct io_buffer_list {
 	__u8 is_mapped;
 	/* ring mapped provided buffers, but mmap'ed by application */
 	__u8 is_mmap;
+	/* buffers are consumed incrementally, see IOU_PBUF_RING_INC */
+	__u8 is_inc;
 };
 
 struct io_buffer {
@@ -41,8 +43,17 @@ struct io_buffer {
 	__u16 bgid;
 };
 
+struct buf_sel_arg {
+	struct iovec *iovs;
+	size_t out_len;
+	size_t max_len;
+	int nr_iovs;
+};
+
 void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 			      unsigned int issue_flags);
+int io_buffers_select(struct io_kiocb *req, struct buf_sel_arg *arg,
+		      unsigned int issue_flags);
 void io_destroy_buffers(struct io_ring_ctx *ctx);
 
 int io_remove_buffers_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe);
@@ -57,7 +68,9 @@ int io_register_pbuf_status(struct io_ring_ctx *ctx, void __user *arg);
 
 void io_kbuf_mmap_list_free(struct io_ring_ctx *ctx);
 
-unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags);
+unsigned int __io_put_kbuf(struct io_kiocb *req, int len, int nbufs,
+			   unsigned issue_flags);
+bool io_kbuf_commit(struct io_buffer_list *bl, int len, int nr);
 
 bool io_kbuf_recycle_legacy(struct io_kiocb *req, unsigned issue_flags);
 
@@ -110,17 +123,20 @@ static inline bool io_kbuf_recycle(struct io_kiocb *req, unsigned issue_flags)
 	return false;
 }
 
-static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req,
-					      struct list_head *list)
+static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req, int len,
+					      int nbufs, struct list_head *list)
 {
 	unsigned int ret = IORING_CQE_F_BUFFER | (req->buf_index << IORING_CQE_BUFFER_SHIFT);
 
 	if (req->flags & REQ_F_BUFFER_RING) {
 		if (req->buf_list) {
 			req->buf_index = req->buf_list->bgid;
-			req->buf_list->head++;
+			if (!io_kbuf_commit(req->buf_list, len, nbufs))
+				ret |= IORING_CQE_F_BUF_MORE;
 		}
-		req->flags &= ~REQ_F_BUFFER_RING;
+		if (req->flags & REQ_F_BUF_MORE)
+			ret |= IORING_CQE_F_BUF_MORE;
+		req->flags &= ~(REQ_F_BUFFER_RING | REQ_F_BUF_MORE);
 	} else {
 		req->buf_index = req->kbuf->bgid;
 		list_add(&req->kbuf->list, list);
@@ -136,15 +152,34 @@ static inline unsigned int io_put_kbuf_comp(struct io_kiocb *req)
 
 	if (!(req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)))
 		return 0;
-	return __io_put_kbuf_list(req, &req->ctx->io_buffers_comp);
+	return __io_put_kbuf_list(req, req->cqe.res, 1,
+				  &req->ctx->io_buffers_comp);
 }
 
-static inline unsigned int io_put_kbuf(struct io_kiocb *req,
+/*
+ * Put the buffer of a request that transferred @len bytes. For
+ * incrementally consumed buffer rings, only @len bytes of the buffer are
+ * consumed and IORING_CQE_F_BUF_MORE is returned if it has room left.
+ */
+static inline unsigned int io_put_kbuf(struct io_kiocb *req, int len,
 				       unsigned issue_flags)
 {
 
 	if (!(req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)))
 		return 0;
-	return __io_put_kbuf(req, issue_flags);
+	return __io_put_kbuf(req, len, 1, issue_flags);
+}
+
+/*
+ * Put buffers selected with io_buffers_select(), of which the transfer
+ * used @nbufs for @len bytes. For ring buffers that haven't been committed
+ * at selection time, consume exactly those from the ring.
+ */
+static inline unsigned int io_put_kbufs(struct io_kiocb *req, int len,
+					int nbufs, unsigned issue_flags)
+{
+	if (!(req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)))
+		return 0;
+	return __io_put_kbuf(req, len, nbufs, issue_flags);
 }
 #endif
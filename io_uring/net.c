@@ -7,6 +7,7 @@
 #include <linux/compat.h>
 #include <net/compat.h>
 #include <linux/io_uring.h>
+#include <linux/security.h>
 
 #include <uapi/linux/io_uring.h>
 
@@ -16,6 +17,7 @@
 #include "net.h"
 #include "notif.h"
 #include "rsrc.h"
+#include "zcrx.h"
 
 #if defined(CONFIG_NET)
 struct io_shutdown {
@@ -50,6 +52,17 @@ struct io_connect {
 	bool				seen_econnaborted;
 };
 
+struct io_bind {
+	struct file			*file;
+	struct sockaddr __user		*addr;
+	int				addr_len;
+};
+
+struct io_listen {
+	struct file			*file;
+	int				backlog;
+};
+
 struct io_sr_msg {
 	struct file			*file;
 	union {
@@ -71,6 +84,14 @@ struct io_sr_msg {
 	struct io_kiocb 		*notif;
 };
 
+struct io_recvzc {
+	struct file			*file;
+	unsigned			msg_flags;
+	u16				flags;
+	u32				len;
+	struct io_zcrx_ifq		*ifq;
+};
+
 /*
  * Number of times we'll try and do receives if there's more data. If we
  * exceed this limit, then add us to the back of the queue and retry from
@@ -378,11 +399,20 @@ int io_sendmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	sr->umsg = u64_to_user_ptr(READ_ONCE(sqe->addr));
 	sr->len = READ_ONCE(sqe->len);
 	sr->flags = READ_ONCE(sqe->ioprio);
-	if (sr->flags & ~IORING_RECVSEND_POLL_FIRST)
+	if (sr->flags & ~(IORING_RECVSEND_POLL_FIRST | IORING_RECVSEND_BUNDLE))
 		return -EINVAL;
 	sr->msg_flags = READ_ONCE(sqe->msg_flags) | MSG_NOSIGNAL;
 	if (sr->msg_flags & MSG_DONTWAIT)
 		req->flags |= REQ_F_NOWAIT;
+	if (sr->flags & IORING_RECVSEND_BUNDLE) {
+		if (req->opcode == IORING_OP_SENDMSG)
+			return -EINVAL;
+		if (!(req->flags & REQ_F_BUFFER_SELECT))
+			return -EINVAL;
+		/* a short bundle can't be resumed, see io_send() */
+		if (sr->msg_flags & MSG_WAITALL)
+			return -EINVAL;
+	}
 
 #ifdef CONFIG_COMPAT
 	if (req->ctx->compat)
@@ -453,14 +483,33 @@ int io_sendmsg(struct io_kiocb *req, unsigned int issue_flags)
 	return IOU_OK;
 }
 
+/*
+ * Returns how many of the @nr_iovs buffers a transfer of @ret bytes used,
+ * a partially used buffer counts as used.
+ */
+static int io_bundle_nbufs(const struct iovec *iovs, int nr_iovs, int ret)
+{
+	int nbufs = 0;
+
+	while (ret > 0 && nbufs < nr_iovs) {
+		ret -= min_t(int, iovs[nbufs].iov_len, ret);
+		nbufs++;
+	}
+	return nbufs;
+}
+
 int io_send(struct io_kiocb *req, unsigned int issue_flags)
 {
 	struct sockaddr_storage __address;
 	struct io_sr_msg *sr = io_kiocb_to_cmd(req, struct io_sr_msg);
+	struct iovec iovs[UIO_FASTIOV];
 	struct msghdr msg;
 	struct socket *sock;
+	unsigned int cflags;
+	size_t len = 0;
 	unsigned flags;
 	int min_ret = 0;
+	int nbufs = 1;
 	int ret;
 
 	msg.msg_name = NULL;
@@ -491,9 +540,35 @@ int io_send(struct io_kiocb *req, unsigned int issue_flags)
 	if (unlikely(!sock))
 		return -ENOTSOCK;
 
-	ret = import_ubuf(WRITE, sr->buf, sr->len, &msg.msg_iter);
-	if (unlikely(ret))
-		return ret;
+	if (io_do_buffer_select(req)) {
+		struct buf_sel_arg arg = {
+			.iovs = iovs,
+			.nr_iovs = 1,
+			.max_len = sr->len,
+		};
+
+		if (sr->flags & IORING_RECVSEND_BUNDLE)
+			arg.nr_iovs = ARRAY_SIZE(iovs);
+		ret = io_buffers_select(req, &arg, issue_flags);
+		if (unlikely(ret < 0))
+			return ret;
+		nbufs = ret;
+		len = arg.out_len;
+		if (nbufs == 1) {
+			sr->buf = iovs[0].iov_base;
+			sr->len = len;
+		}
+	}
+
+	if (nbufs > 1) {
+		iov_iter_init(&msg.msg_iter, ITER_SOURCE, iovs, nbufs, len);
+	} else {
+		ret = import_ubuf(ITER_SOURCE, sr->buf, sr->len, &msg.msg_iter);
+		if (unlikely(ret)) {
+			io_kbuf_recycle(req, issue_flags);
+			return ret;
+		}
+	}
 
 	flags = sr->msg_flags;
 	if (issue_flags & IO_URING_F_NONBLOCK)
@@ -508,6 +583,7 @@ int io_send(struct io_kiocb *req, unsigned int issue_flags)
 		if (ret == -EAGAIN && (issue_flags & IO_URING_F_NONBLOCK))
 			return io_setup_async_addr(req, &__address, issue_flags);
 
+		/* bundles reject MSG_WAITALL, this is a single buffer */
 		if (ret > 0 && io_net_retry(sock, flags)) {
 			sr->len -= ret;
 			sr->buf += ret;
@@ -523,7 +599,13 @@ int io_send(struct io_kiocb *req, unsigned int issue_flags)
 		ret += sr->done_io;
 	else if (sr->done_io)
 		ret = sr->done_io;
-	io_req_set_res(req, ret, 0);
+	else
+		io_kbuf_recycle(req, issue_flags);
+
+	if (nbufs > 1)
+		nbufs = io_bundle_nbufs(iovs, nbufs, ret);
+	cflags = io_put_kbufs(req, ret, nbufs, issue_flags);
+	io_req_set_res(req, ret, cflags);
 	return IOU_OK;
 }
 
@@ -605,7 +687,8 @@ int io_recvmsg_prep_async(struct io_kiocb *req)
 	return ret;
 }
 
-#define RECVMSG_FLAGS (IORING_RECVSEND_POLL_FIRST | IORING_RECV_MULTISHOT)
+#define RECVMSG_FLAGS (IORING_RECVSEND_POLL_FIRST | IORING_RECV_MULTISHOT | \
+			IORING_RECVSEND_BUNDLE)
 
 int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
@@ -626,6 +709,15 @@ int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		req->flags |= REQ_F_NOWAIT;
 	if (sr->msg_flags & MSG_ERRQUEUE)
 		req->flags |= REQ_F_CLEAR_POLLIN;
+	if (sr->flags & IORING_RECVSEND_BUNDLE) {
+		if (req->opcode == IORING_OP_RECVMSG)
+			return -EINVAL;
+		if (!(req->flags & REQ_F_BUFFER_SELECT))
+			return -EINVAL;
+		/* a short bundle can't be resumed, see io_recv() */
+		if (sr->msg_flags & MSG_WAITALL)
+			return -EINVAL;
+	}
 	if (sr->flags & IORING_RECV_MULTISHOT) {
 		if (!(req->flags & REQ_F_BUFFER_SELECT))
 			return -EINVAL;
@@ -670,11 +762,11 @@ static inline void io_recv_prep_retry(struct io_kiocb *req)
  */
 static inline bool io_recv_finish(struct io_kiocb *req, int *ret,
 				  struct msghdr *msg, bool mshot_finished,
-				  unsigned issue_flags)
+				  int nbufs, unsigned issue_flags)
 {
 	unsigned int cflags;
 
-	cflags = io_put_kbuf(req, issue_flags);
+	cflags = io_put_kbufs(req, *ret, nbufs, issue_flags);
 	if (msg->msg_inq && msg->msg_inq != -1)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 
@@ -899,7 +991,8 @@ int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 	else
 		io_kbuf_recycle(req, issue_flags);
 
-	if (!io_recv_finish(req, &ret, &kmsg->msg, mshot_finished, issue_flags))
+	if (!io_recv_finish(req, &ret, &kmsg->msg, mshot_finished, 1,
+			    issue_flags))
 		goto retry_multishot;
 
 	if (mshot_finished) {
@@ -917,12 +1010,14 @@ int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 {
 	struct io_sr_msg *sr = io_kiocb_to_cmd(req, struct io_sr_msg);
+	struct iovec iovs[UIO_FASTIOV];
 	struct msghdr msg;
 	struct socket *sock;
 	unsigned flags;
 	int ret, min_ret = 0;
 	bool force_nonblock = issue_flags & IO_URING_F_NONBLOCK;
 	size_t len = sr->len;
+	int nbufs;
 
 	if (!(req->flags & REQ_F_POLLED) &&
 	    (sr->flags & IORING_RECVSEND_POLL_FIRST))
@@ -945,7 +1040,24 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 		flags |= MSG_DONTWAIT;
 
 retry_multishot:
-	if (io_do_buffer_select(req)) {
+	nbufs = 1;
+	if (io_do_buffer_select(req) && (sr->flags & IORING_RECVSEND_BUNDLE)) {
+		struct buf_sel_arg arg = {
+			.iovs = iovs,
+			.nr_iovs = ARRAY_SIZE(iovs),
+			.max_len = sr->len,
+		};
+
+		ret = io_buffers_select(req, &arg, issue_flags);
+		if (unlikely(ret < 0))
+			return ret;
+		nbufs = ret;
+		len = arg.out_len;
+		if (nbufs == 1) {
+			sr->buf = iovs[0].iov_base;
+			sr->len = len;
+		}
+	} else if (io_do_buffer_select(req)) {
 		void __user *buf;
 
 		buf = io_buffer_select(req, &len, issue_flags);
@@ -955,9 +1067,13 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 		sr->len = len;
 	}
 
-	ret = import_ubuf(READ, sr->buf, len, &msg.msg_iter);
-	if (unlikely(ret))
-		goto out_free;
+	if (nbufs > 1) {
+		iov_iter_init(&msg.msg_iter, ITER_DEST, iovs, nbufs, len);
+	} else {
+		ret = import_ubuf(READ, sr->buf, len, &msg.msg_iter);
+		if (unlikely(ret))
+			goto out_free;
+	}
 
 	msg.msg_inq = -1;
 	msg.msg_flags = 0;
@@ -997,12 +1113,87 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 	else
 		io_kbuf_recycle(req, issue_flags);
 
-	if (!io_recv_finish(req, &ret, &msg, ret <= 0, issue_flags))
+	if (nbufs > 1)
+		nbufs = io_bundle_nbufs(iovs, nbufs, ret);
+	if (!io_recv_finish(req, &ret, &msg, ret <= 0, nbufs, issue_flags))
 		goto retry_multishot;
 
 	return ret;
 }
 
+int io_recvzc_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_recvzc *zc = io_kiocb_to_cmd(req, struct io_recvzc);
+	unsigned ifq_idx;
+
+	if (unlikely(sqe->addr2 || sqe->addr || sqe->addr3))
+		return -EINVAL;
+
+	ifq_idx = READ_ONCE(sqe->zcrx_ifq_idx);
+	if (ifq_idx != 0)
+		return -EINVAL;
+	zc->ifq = req->ctx->ifq;
+	if (!zc->ifq)
+		return -EINVAL;
+
+	zc->len = READ_ONCE(sqe->len);
+	zc->flags = READ_ONCE(sqe->ioprio);
+	zc->msg_flags = READ_ONCE(sqe->msg_flags);
+	if (zc->msg_flags)
+		return -EINVAL;
+	if (zc->flags & ~(IORING_RECVSEND_POLL_FIRST | IORING_RECV_MULTISHOT))
+		return -EINVAL;
+	/* multishot required, all data completions are posted as aux CQEs */
+	if (!(zc->flags & IORING_RECV_MULTISHOT))
+		return -EINVAL;
+	req->flags |= REQ_F_APOLL_MULTISHOT;
+	return 0;
+}
+
+int io_recvzc(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_recvzc *zc = io_kiocb_to_cmd(req, struct io_recvzc);
+	struct socket *sock;
+	unsigned int len;
+	int ret;
+
+	if (!(req->flags & REQ_F_POLLED) &&
+	    (zc->flags & IORING_RECVSEND_POLL_FIRST))
+		return -EAGAIN;
+
+	sock = sock_from_file(req->file);
+	if (unlikely(!sock))
+		return -ENOTSOCK;
+
+	len = zc->len;
+	ret = io_zcrx_recv(req, zc->ifq, sock, zc->msg_flags | MSG_DONTWAIT,
+			   issue_flags, &zc->len);
+	if (len && zc->len == 0) {
+		io_req_set_res(req, 0, 0);
+
+		if (issue_flags & IO_URING_F_MULTISHOT)
+			return IOU_STOP_MULTISHOT;
+		return IOU_OK;
+	}
+	if (unlikely(ret <= 0) && ret != -EAGAIN) {
+		if (ret == -ERESTARTSYS)
+			ret = -EINTR;
+		if (ret == IOU_REQUEUE)
+			return IOU_REQUEUE;
+
+		req_set_fail(req);
+		io_req_set_res(req, ret, 0);
+
+		if (issue_flags & IO_URING_F_MULTISHOT)
+			return IOU_STOP_MULTISHOT;
+		return IOU_OK;
+	}
+
+	if (issue_flags & IO_URING_F_MULTISHOT)
+		return IOU_ISSUE_SKIP_COMPLETE;
+	return -EAGAIN;
+}
+
 void io_send_zc_cleanup(struct io_kiocb *req)
 {
 	struct io_sr_msg *zc = io_kiocb_to_cmd(req, struct io_sr_msg);
@@ -1562,6 +1753,87 @@ int io_connect(struct io_kiocb *req, unsigned int issue_flags)
 	return IOU_OK;
 }
 
+/*
+ * BIND and LISTEN work on the socket directly rather than through
+ * __sys_bind() and __sys_listen(), so that they can be used on fixed files
+ * that have no entry in the file table.
+ */
+int io_bind_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_bind *bind = io_kiocb_to_cmd(req, struct io_bind);
+
+	if (sqe->len || sqe->buf_index || sqe->rw_flags || sqe->splice_fd_in)
+		return -EINVAL;
+
+	bind->addr = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	bind->addr_len = READ_ONCE(sqe->addr2);
+	return 0;
+}
+
+int io_bind(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_bind *bind = io_kiocb_to_cmd(req, struct io_bind);
+	struct sockaddr_storage address;
+	struct socket *sock;
+	int ret;
+
+	sock = sock_from_file(req->file);
+	if (unlikely(!sock))
+		return -ENOTSOCK;
+
+	ret = move_addr_to_kernel(bind->addr, bind->addr_len, &address);
+	if (ret)
+		goto out;
+	ret = security_socket_bind(sock, (struct sockaddr *)&address,
+				   bind->addr_len);
+	if (ret)
+		goto out;
+	ret = READ_ONCE(sock->ops)->bind(sock, (struct sockaddr *)&address,
+					 bind->addr_len);
+out:
+	if (ret < 0)
+		req_set_fail(req);
+	io_req_set_res(req, ret, 0);
+	return IOU_OK;
+}
+
+int io_listen_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_listen *listen = io_kiocb_to_cmd(req, struct io_listen);
+
+	if (sqe->addr || sqe->buf_index || sqe->rw_flags || sqe->splice_fd_in ||
+	    sqe->addr2)
+		return -EINVAL;
+
+	listen->backlog = READ_ONCE(sqe->len);
+	return 0;
+}
+
+int io_listen(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_listen *listen = io_kiocb_to_cmd(req, struct io_listen);
+	struct socket *sock;
+	int somaxconn, backlog;
+	int ret;
+
+	sock = sock_from_file(req->file);
+	if (unlikely(!sock))
+		return -ENOTSOCK;
+
+	backlog = listen->backlog;
+	somaxconn = READ_ONCE(sock_net(sock->sk)->core.sysctl_somaxconn);
+	if ((unsigned int)backlog > somaxconn)
+		backlog = somaxconn;
+
+	ret = security_socket_listen(sock, backlog);
+	if (!ret)
+		ret = READ_ONCE(sock->ops)->listen(sock, backlog);
+	if (ret < 0)
+		req_set_fail(req);
+	io_req_set_res(req, ret, 0);
+	return IOU_OK;
+}
+
 void io_netmsg_cache_free(struct io_cache_entry *entry)
 {
 	kfree(container_of(entry, struct io_async_msghdr, cache));
@@ -19,6 +19,7 @@
 #include "kbuf.h"
 #include "poll.h"
 #include "cancel.h"
+#include "napi.h"
 
 struct io_poll_update {
 	struct file			*file;
@@ -636,6 +637,8 @@ static int __io_arm_poll_handler(struct io_kiocb *req,
 		return ipt->error ?: -EINVAL;
 	}
 
+	io_napi_add(req);
+
 	if (mask &&
 	   ((poll->events & (EPOLLET|EPOLLONESHOT)) == (EPOLLET|EPOLLONESHOT))) {
 		if (!io_poll_can_finish_inline(req, ipt)) {
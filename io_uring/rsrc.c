@@ -15,6 +15,7 @@
 #include "io_uring.h"
 #include "openclose.h"
 #include "rsrc.h"
+#include "register.h"
 
 struct io_rsrc_update {
 	struct file			*file;
@@ -138,12 +139,15 @@ static void io_buffer_unmap(struct io_ring_ctx *ctx, struct io_mapped_ubuf **slo
 	unsigned int i;
 
 	if (imu != &dummy_ubuf) {
+		if (!refcount_dec_and_test(&imu->refs))
+			goto out;
 		for (i = 0; i < imu->nr_bvecs; i++)
 			unpin_user_page(imu->bvec[i].bv_page);
 		if (imu->acct_pages)
 			io_unaccount_mem(ctx, imu->acct_pages);
 		kvfree(imu);
 	}
+out:
 	*slot = NULL;
 }
 
@@ -1000,6 +1004,7 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	imu->ubuf = (unsigned long) iov->iov_base;
 	imu->ubuf_end = imu->ubuf + iov->iov_len;
 	imu->nr_bvecs = nr_pages;
+	refcount_set(&imu->refs, 1);
 	*pimu = imu;
 	ret = 0;
 
@@ -1082,6 +1087,108 @@ int io_sqe_buffers_register(struct io_ring_ctx *ctx, void __user *arg,
 	return ret;
 }
 
+static int io_clone_buffers(struct io_ring_ctx *ctx, struct io_ring_ctx *src_ctx)
+{
+	struct io_mapped_ubuf **user_bufs;
+	struct io_rsrc_data *data;
+	int i, ret, nbufs;
+
+	/*
+	 * Pinned pages stay accounted to whoever registered them and are
+	 * unaccounted by the last ring to drop them, so both must agree.
+	 */
+	if (src_ctx->user != ctx->user || src_ctx->mm_account != ctx->mm_account)
+		return -EPERM;
+
+	/*
+	 * Drop our own lock here. We'll setup the data we need and reference
+	 * the source buffers, then re-grab, check, and assign at the end.
+	 * Holding both at once could deadlock against a clone going the
+	 * other way.
+	 */
+	mutex_unlock(&ctx->uring_lock);
+
+	mutex_lock(&src_ctx->uring_lock);
+	ret = -ENXIO;
+	nbufs = src_ctx->nr_user_bufs;
+	if (!nbufs)
+		goto out_unlock;
+	ret = io_rsrc_data_alloc(ctx, IORING_RSRC_BUFFER, NULL, nbufs, &data);
+	if (ret)
+		goto out_unlock;
+
+	ret = -ENOMEM;
+	user_bufs = kcalloc(nbufs, sizeof(*ctx->user_bufs), GFP_KERNEL);
+	if (!user_bufs)
+		goto out_free_data;
+
+	for (i = 0; i < nbufs; i++) {
+		struct io_mapped_ubuf *src = src_ctx->user_bufs[i];
+
+		if (src != &dummy_ubuf)
+			refcount_inc(&src->refs);
+		user_bufs[i] = src;
+	}
+
+	/* Have a ref on the bufs now, drop src lock and re-grab our own lock */
+	mutex_unlock(&src_ctx->uring_lock);
+	mutex_lock(&ctx->uring_lock);
+	if (!ctx->user_bufs) {
+		ctx->user_bufs = user_bufs;
+		ctx->buf_data = data;
+		ctx->nr_user_bufs = nbufs;
+		return 0;
+	}
+
+	/* someone raced setting up buffers, dump ours */
+	for (i = 0; i < nbufs; i++)
+		io_buffer_unmap(ctx, &user_bufs[i]);
+	io_rsrc_data_free(data);
+	kfree(user_bufs);
+	return -EBUSY;
+out_free_data:
+	io_rsrc_data_free(data);
+out_unlock:
+	mutex_unlock(&src_ctx->uring_lock);
+	mutex_lock(&ctx->uring_lock);
+	return ret;
+}
+
+/*
+ * Copy the registered buffers from the source ring whose file descriptor
+ * is given in the src_fd to the current ring. This is identical to registering
+ * the buffers with ctx, except faster as mappings already exist.
+ *
+ * Since the memory is already accounted once, don't account it again. The
+ * buffers are refcounted, and stay pinned until every ring using them has
+ * unregistered them.
+ */
+int io_register_clone_buffers(struct io_ring_ctx *ctx, void __user *arg)
+{
+	struct io_uring_clone_buffers buf;
+	bool registered_src;
+	struct file *file;
+	int ret;
+
+	if (ctx->user_bufs || ctx->nr_user_bufs)
+		return -EBUSY;
+	if (copy_from_user(&buf, arg, sizeof(buf)))
+		return -EFAULT;
+	if (buf.flags & ~IORING_REGISTER_SRC_REGISTERED)
+		return -EINVAL;
+	if (memchr_inv(buf.pad, 0, sizeof(buf.pad)))
+		return -EINVAL;
+
+	registered_src = (buf.flags & IORING_REGISTER_SRC_REGISTERED) != 0;
+	file = io_uring_register_get_file(buf.src_fd, registered_src);
+	if (IS_ERR(file))
+		return PTR_ERR(file);
+	ret = io_clone_buffers(ctx, file->private_data);
+	if (!registered_src)
+		fput(file);
+	return ret;
+}
+
 int io_import_fixed(int ddir, struct iov_iter *iter,
 			   struct io_mapped_ubuf *imu,
 			   u64 buf_addr, size_t len)
@@ -1149,3 +1256,75 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 
 	return 0;
 }
+
+/*
+ * Import @nr_iovs iovecs, each of which has to lie within the registered
+ * buffer @imu, as a bvec iterator. The bvecs are built in a new array as the
+ * segments needn't line up with the ones of the buffer, it's returned for
+ * the caller to kvfree() once the I/O is done. The pages stay pinned by the
+ * buffer registration, nothing is pinned here.
+ */
+struct bio_vec *io_import_reg_vec(int ddir, struct iov_iter *iter,
+				  struct io_mapped_ubuf *imu,
+				  const struct iovec *iov, unsigned int nr_iovs)
+{
+	unsigned int i, nr_bvecs = 0;
+	struct bio_vec *bvec;
+	size_t total = 0;
+
+	if (WARN_ON_ONCE(!imu))
+		return ERR_PTR(-EFAULT);
+
+	for (i = 0; i < nr_iovs; i++) {
+		u64 buf_addr = (unsigned long)iov[i].iov_base;
+		u64 buf_end;
+
+		if (!iov[i].iov_len)
+			continue;
+		if (unlikely(check_add_overflow(buf_addr, (u64)iov[i].iov_len,
+						&buf_end)))
+			return ERR_PTR(-EFAULT);
+		if (unlikely(buf_addr < imu->ubuf || buf_end > imu->ubuf_end))
+			return ERR_PTR(-EFAULT);
+		/* huge page buffers are a single bvec, see io_import_fixed() */
+		if (imu->nr_bvecs == 1)
+			nr_bvecs++;
+		else
+			nr_bvecs += (iov[i].iov_len >> PAGE_SHIFT) + 2;
+	}
+
+	bvec = kvmalloc_array(nr_bvecs, sizeof(*bvec), GFP_KERNEL);
+	if (!bvec)
+		return ERR_PTR(-ENOMEM);
+
+	nr_bvecs = 0;
+	for (i = 0; i < nr_iovs; i++) {
+		const struct bio_vec *src = imu->bvec;
+		size_t len = iov[i].iov_len;
+		size_t offset;
+
+		if (!len)
+			continue;
+		offset = (unsigned long)iov[i].iov_base - imu->ubuf;
+		if (offset >= src->bv_len) {
+			offset -= src->bv_len;
+			src += 1 + (offset >> PAGE_SHIFT);
+			offset &= ~PAGE_MASK;
+		}
+
+		while (len) {
+			size_t this_len = min_t(size_t, len,
+						src->bv_len - offset);
+
+			bvec_set_page(&bvec[nr_bvecs++], src->bv_page, this_len,
+				      src->bv_offset + offset);
+			total += this_len;
+			len -= this_len;
+			offset = 0;
+			src++;
+		}
+	}
+
+	iov_iter_bvec(iter, ddir, bvec, nr_bvecs, total);
+	return bvec;
+}
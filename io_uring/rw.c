@@ -166,7 +166,8 @@ void io_readv_writev_cleanup(struct io_kiocb *req)
 {
 	struct io_async_rw *io = req->async_data;
 
-	kfree(io->free_iovec);
+	kvfree(io->free_iovec);
+	kvfree(io->bvec);
 }
 
 static inline loff_t *io_kiocb_update_pos(struct io_kiocb *req)
@@ -313,7 +314,7 @@ void io_req_rw_complete(struct io_kiocb *req, struct io_tw_state *ts)
 	if (req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)) {
 		unsigned issue_flags = ts->locked ? 0 : IO_URING_F_UNLOCKED;
 
-		req->cqe.flags |= io_put_kbuf(req, issue_flags);
+		req->cqe.flags |= io_put_kbuf(req, req->cqe.res, issue_flags);
 	}
 	io_req_task_complete(req, ts);
 }
@@ -394,7 +395,7 @@ static int kiocb_done(struct io_kiocb *req, ssize_t ret,
 			 */
 			io_req_io_end(req);
 			io_req_set_res(req, final_ret,
-				       io_put_kbuf(req, issue_flags));
+				       io_put_kbuf(req, final_ret, issue_flags));
 			return IOU_OK;
 		}
 	} else {
@@ -411,6 +412,48 @@ static int kiocb_done(struct io_kiocb *req, ssize_t ret,
 	return IOU_ISSUE_SKIP_COMPLETE;
 }
 
+static inline bool io_rw_is_reg_vec(struct io_kiocb *req)
+{
+	return req->opcode == IORING_OP_READV_FIXED ||
+	       req->opcode == IORING_OP_WRITEV_FIXED;
+}
+
+/*
+ * The iovecs of READV_FIXED and WRITEV_FIXED point into the registered
+ * buffer, turn them into bvecs. Block devices may hand the bvec array to
+ * bios as is, so it's kept in the async data, which @s must belong to, and
+ * freed along with the request.
+ */
+static struct iovec *io_import_rw_reg_vec(int ddir, struct io_kiocb *req,
+					  struct io_rw_state *s)
+{
+	struct io_rw *rw = io_kiocb_to_cmd(req, struct io_rw);
+	struct io_async_rw *io = req->async_data;
+	struct iov_iter *iter = &s->iter;
+	struct iovec *iovec = s->fast_iov;
+	struct bio_vec *bvec;
+	ssize_t ret;
+
+	if (WARN_ON_ONCE(!req_has_async_data(req) || s != &io->s))
+		return ERR_PTR(-EFAULT);
+
+	ret = __import_iovec(ddir, u64_to_user_ptr(rw->addr), rw->len,
+			     UIO_FASTIOV, &iovec, iter, req->ctx->compat);
+	if (unlikely(ret < 0))
+		return ERR_PTR(ret);
+
+	bvec = io_import_reg_vec(ddir, iter, req->imu, iter_iov(iter),
+				 iter->nr_segs);
+	kfree(iovec);
+	if (IS_ERR(bvec))
+		return ERR_CAST(bvec);
+
+	kvfree(io->bvec);
+	io->bvec = bvec;
+	req->flags |= REQ_F_NEED_CLEANUP;
+	return NULL;
+}
+
 static struct iovec *__io_import_iovec(int ddir, struct io_kiocb *req,
 				       struct io_rw_state *s,
 				       unsigned int issue_flags)
@@ -429,6 +472,8 @@ static struct iovec *__io_import_iovec(int ddir, struct io_kiocb *req,
 			return ERR_PTR(ret);
 		return NULL;
 	}
+	if (opcode == IORING_OP_READV_FIXED || opcode == IORING_OP_WRITEV_FIXED)
+		return io_import_rw_reg_vec(ddir, req, s);
 
 	buf = u64_to_user_ptr(rw->addr);
 	sqe_len = rw->len;
@@ -494,6 +539,10 @@ static ssize_t loop_rw_iter(int ddir, struct io_rw *rw, struct iov_iter *iter)
 	if ((kiocb->ki_flags & IOCB_NOWAIT) &&
 	    !(kiocb->ki_filp->f_flags & O_NONBLOCK))
 		return -EAGAIN;
+	/* the bvec case below only knows about a single fixed buffer range */
+	if (iov_iter_is_bvec(iter) &&
+	    io_issue_defs[cmd_to_io_kiocb(rw)->opcode].vectored)
+		return -EOPNOTSUPP;
 
 	ppos = io_kiocb_ppos(kiocb);
 
@@ -546,6 +595,7 @@ static void io_req_map_rw(struct io_kiocb *req, const struct iovec *iovec,
 
 	memcpy(&io->s.iter, iter, sizeof(*iter));
 	io->free_iovec = iovec;
+	io->bvec = NULL;
 	io->bytes_done = 0;
 	/* can only be fixed buffers, no need to do anything */
 	if (iov_iter_is_bvec(iter) || iter_is_ubuf(iter))
@@ -578,7 +628,7 @@ static int io_setup_async_rw(struct io_kiocb *req, const struct iovec *iovec,
 		struct io_async_rw *iorw;
 
 		if (io_alloc_async_data(req)) {
-			kfree(iovec);
+			kvfree(iovec);
 			return -ENOMEM;
 		}
 
@@ -598,6 +648,7 @@ static inline int io_rw_prep_async(struct io_kiocb *req, int rw)
 
 	iorw->bytes_done = 0;
 	iorw->free_iovec = NULL;
+	iorw->bvec = NULL;
 
 	/* submission path, ->uring_lock should already be taken */
 	ret = io_import_iovec(rw, req, &iov, &iorw->s, 0);
@@ -770,6 +821,15 @@ static int __io_read(struct io_kiocb *req, unsigned int issue_flags)
 	ssize_t ret, ret2;
 	loff_t *ppos;
 
+	/* the bvecs of vectored fixed buffers must outlive the issue */
+	if (!req_has_async_data(req) && io_rw_is_reg_vec(req)) {
+		if (io_alloc_async_data(req))
+			return -ENOMEM;
+		ret = io_rw_prep_async(req, ITER_DEST);
+		if (unlikely(ret))
+			return ret;
+	}
+
 	if (!req_has_async_data(req)) {
 		ret = io_import_iovec(ITER_DEST, req, &iovec, s, issue_flags);
 		if (unlikely(ret < 0))
@@ -798,7 +858,7 @@ static int __io_read(struct io_kiocb *req, unsigned int issue_flags)
 	}
 	ret = io_rw_init_file(req, FMODE_READ);
 	if (unlikely(ret)) {
-		kfree(iovec);
+		kvfree(iovec);
 		return ret;
 	}
 	req->cqe.res = iov_iter_count(&s->iter);
@@ -819,7 +879,7 @@ static int __io_read(struct io_kiocb *req, unsigned int issue_flags)
 
 	ret = rw_verify_area(READ, req->file, ppos, req->cqe.res);
 	if (unlikely(ret)) {
-		kfree(iovec);
+		kvfree(iovec);
 		return ret;
 	}
 
@@ -842,7 +902,7 @@ static int __io_read(struct io_kiocb *req, unsigned int issue_flags)
 		ret = 0;
 	} else if (ret == -EIOCBQUEUED) {
 		if (iovec)
-			kfree(iovec);
+			kvfree(iovec);
 		return IOU_ISSUE_SKIP_COMPLETE;
 	} else if (ret == req->cqe.res || ret <= 0 || !force_nonblock ||
 		   (req->flags & REQ_F_NOWAIT) || !need_complete_io(req)) {
@@ -906,7 +966,7 @@ static int __io_read(struct io_kiocb *req, unsigned int issue_flags)
 done:
 	/* it's faster to check here then delegate to kfree */
 	if (iovec)
-		kfree(iovec);
+		kvfree(iovec);
 	return ret;
 }
 
@@ -966,7 +1026,7 @@ int io_read_mshot(struct io_kiocb *req, unsigned int issue_flags)
 		 * Put our buffer and post a CQE. If we fail to post a CQE, then
 		 * jump to the termination path. This request is then done.
 		 */
-		cflags = io_put_kbuf(req, issue_flags);
+		cflags = io_put_kbuf(req, ret, issue_flags);
 		rw->len = 0; /* similarly to above, reset len to 0 */
 
 		if (io_fill_cqe_req_aux(req,
@@ -1005,6 +1065,15 @@ int io_write(struct io_kiocb *req, unsigned int issue_flags)
 	ssize_t ret, ret2;
 	loff_t *ppos;
 
+	/* the bvecs of vectored fixed buffers must outlive the issue */
+	if (!req_has_async_data(req) && io_rw_is_reg_vec(req)) {
+		if (io_alloc_async_data(req))
+			return -ENOMEM;
+		ret = io_rw_prep_async(req, ITER_SOURCE);
+		if (unlikely(ret))
+			return ret;
+	}
+
 	if (!req_has_async_data(req)) {
 		ret = io_import_iovec(ITER_SOURCE, req, &iovec, s, issue_flags);
 		if (unlikely(ret < 0))
@@ -1018,7 +1087,7 @@ int io_write(struct io_kiocb *req, unsigned int issue_flags)
 	}
 	ret = io_rw_init_file(req, FMODE_WRITE);
 	if (unlikely(ret)) {
-		kfree(iovec);
+		kvfree(iovec);
 		return ret;
 	}
 	req->cqe.res = iov_iter_count(&s->iter);
@@ -1044,7 +1113,7 @@ int io_write(struct io_kiocb *req, unsigned int issue_flags)
 
 	ret = rw_verify_area(WRITE, req->file, ppos, req->cqe.res);
 	if (unlikely(ret)) {
-		kfree(iovec);
+		kvfree(iovec);
 		return ret;
 	}
 
@@ -1115,7 +1184,7 @@ int io_write(struct io_kiocb *req, unsigned int issue_flags)
 	}
 	/* it's reportedly faster than delegating the null check to kfree() */
 	if (iovec)
-		kfree(iovec);
+		kvfree(iovec);
 	return ret;
 }
 
@@ -1189,7 +1258,7 @@ int io_do_iopoll(struct io_ring_ctx *ctx, bool force_nonspin)
 		if (!smp_load_acquire(&req->iopoll_completed))
 			break;
 		nr_events++;
-		req->cqe.flags = io_put_kbuf(req, 0);
+		req->cqe.flags = io_put_kbuf(req, req->cqe.res, 0);
 	}
 	if (unlikely(!nr_events))
 		return 0;
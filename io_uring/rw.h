@@ -11,6 +11,8 @@ struct io_rw_state {
 struct io_async_rw {
 	struct io_rw_state		s;
 	const struct iovec		*free_iovec;
+	/* READV_FIXED and WRITEV_FIXED, the iter points into it */
+	struct bio_vec			*bvec;
 	size_t				bytes_done;
 	struct wait_page_queue		wpq;
 };
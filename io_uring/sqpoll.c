@@ -16,6 +16,7 @@
 
 #include "io_uring.h"
 #include "sqpoll.h"
+#include "napi.h"
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
 
@@ -268,6 +269,10 @@ static int io_sq_thread(void *data)
 		if (io_run_task_work())
 			sqt_spin = true;
 
+		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
+			if (io_napi(ctx))
+				io_napi_sqpoll_busy_poll(ctx);
+
 		if (sqt_spin || !time_after(jiffies, timeout)) {
 			if (sqt_spin)
 				timeout = jiffies + sqd->sq_thread_idle;
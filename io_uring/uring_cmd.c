@@ -111,12 +111,21 @@ EXPORT_SYMBOL_GPL(io_uring_cmd_done);
 int io_uring_cmd_prep_async(struct io_kiocb *req)
 {
 	struct io_uring_cmd *ioucmd = io_kiocb_to_cmd(req, struct io_uring_cmd);
+	struct io_async_cmd *ac = req->async_data;
 
-	memcpy(req->async_data, ioucmd->sqe, uring_sqe_size(req->ctx));
-	ioucmd->sqe = req->async_data;
+	memcpy(ac->sqes, ioucmd->sqe, uring_sqe_size(req->ctx));
+	ioucmd->sqe = ac->sqes;
+	ac->bvec = NULL;
 	return 0;
 }
 
+void io_uring_cmd_cleanup(struct io_kiocb *req)
+{
+	struct io_async_cmd *ac = req->async_data;
+
+	kvfree(ac->bvec);
+}
+
 int io_uring_cmd_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	struct io_uring_cmd *ioucmd = io_kiocb_to_cmd(req, struct io_uring_cmd);
@@ -201,6 +210,49 @@ int io_uring_cmd_import_fixed(u64 ubuf, unsigned long len, int rw,
 }
 EXPORT_SYMBOL_GPL(io_uring_cmd_import_fixed);
 
+/*
+ * Vectored variant of io_uring_cmd_import_fixed(): @uvec is a user array of
+ * @uvec_segs iovecs, each within the registered buffer of the command. The
+ * bvec array @iter is set up on is owned by the request and stays around
+ * until the request is freed, so it may be handed to the block layer as is.
+ */
+int io_uring_cmd_import_fixed_vec(struct io_uring_cmd *ioucmd,
+				  const struct iovec __user *uvec,
+				  unsigned long uvec_segs, int ddir,
+				  struct iov_iter *iter)
+{
+	struct io_kiocb *req = cmd_to_io_kiocb(ioucmd);
+	struct iovec fast_iov[UIO_FASTIOV], *iov = fast_iov;
+	struct io_async_cmd *ac;
+	struct bio_vec *bvec;
+	ssize_t ret;
+
+	if (!req_has_async_data(req)) {
+		if (io_alloc_async_data(req))
+			return -ENOMEM;
+		io_uring_cmd_prep_async(req);
+	}
+	ac = req->async_data;
+
+	ret = __import_iovec(ddir, uvec, uvec_segs, UIO_FASTIOV, &iov, iter,
+			     req->ctx->compat);
+	if (unlikely(ret < 0))
+		return ret;
+
+	bvec = io_import_reg_vec(ddir, iter, req->imu, iter_iov(iter),
+				 iter->nr_segs);
+	kfree(iov);
+	if (IS_ERR(bvec))
+		return PTR_ERR(bvec);
+
+	/* a reissue imports again */
+	kvfree(ac->bvec);
+	ac->bvec = bvec;
+	req->flags |= REQ_F_NEED_CLEANUP;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(io_uring_cmd_import_fixed_vec);
+
 static inline int io_uring_cmd_getsockopt(struct socket *sock,
 					  struct io_uring_cmd *cmd,
 					  unsigned int issue_flags)
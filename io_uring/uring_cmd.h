@@ -1,5 +1,13 @@
 // SPDX-License-Identifier: GPL-2.0
 
+struct io_async_cmd {
+	/* copy of the SQE, for commands that go async */
+	struct io_uring_sqe		sqes[2];
+	/* built by io_uring_cmd_import_fixed_vec(), freed on cleanup */
+	struct bio_vec			*bvec;
+};
+
 int io_uring_cmd(struct io_kiocb *req, unsigned int issue_flags);
 int io_uring_cmd_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe);
 int io_uring_cmd_prep_async(struct io_kiocb *req);
+void io_uring_cmd_cleanup(struct io_kiocb *req);
@@ -0,0 +1,726 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/mm.h>
+#include <linux/highmem.h>
+#include <linux/poison.h>
+#include <linux/rtnetlink.h>
+#include <linux/io_uring.h>
+
+#include <net/page_pool/helpers.h>
+#include <net/page_pool/memory_provider.h>
+#include <net/busy_poll.h>
+#include <net/tcp.h>
+
+#include <uapi/linux/io_uring.h>
+
+#include "io_uring.h"
+#include "rsrc.h"
+#include "zcrx.h"
+
+#if defined(CONFIG_PAGE_POOL) && defined(CONFIG_INET)
+
+#define IO_RQ_MAX_ENTRIES		32768
+#define IO_ZCRX_AREA_MAX_PAGES		(1U << 20)
+
+/* bounds the time spent in one issue, the rest is picked up on requeue */
+#define IO_SKBS_PER_CALL_LIMIT		20
+
+struct io_zcrx_args {
+	struct io_kiocb		*req;
+	struct io_zcrx_ifq	*ifq;
+	unsigned		nr_skbs;
+};
+
+static void io_zcrx_return_page(struct io_zcrx_area *area, u32 idx)
+{
+	spin_lock_bh(&area->freelist_lock);
+	if (!WARN_ON_ONCE(area->free_count >= area->nr_pages))
+		area->freelist[area->free_count++] = idx;
+	spin_unlock_bh(&area->freelist_lock);
+}
+
+static int __io_zcrx_get_free(struct io_zcrx_area *area)
+{
+	int idx = -1;
+
+	spin_lock_bh(&area->freelist_lock);
+	if (area->free_count)
+		idx = area->freelist[--area->free_count];
+	spin_unlock_bh(&area->freelist_lock);
+	return idx;
+}
+
+static bool io_zcrx_page_is_pp(struct page *page)
+{
+	return (page->pp_magic & ~0x3UL) == PP_SIGNATURE;
+}
+
+/*
+ * Drop @nr buffer references on a page.  A page_pool page goes back to its
+ * pool once the skbs are done with it too; a copy fallback page goes back
+ * to the freelist.
+ */
+static void io_zcrx_put_refs(struct io_zcrx_area *area, u32 idx, int nr)
+{
+	struct page *page = area->pages[idx];
+
+	if (io_zcrx_page_is_pp(page)) {
+		if (!page_pool_unref_page(page, nr))
+			page_pool_put_unrefed_page(page->pp, page, -1, false);
+		return;
+	}
+	if (atomic_sub_and_test(nr, &area->refs[idx]))
+		io_zcrx_return_page(area, idx);
+}
+
+/* Drop a buffer handed back by the user, ignoring ones it doesn't hold */
+static void io_zcrx_put_user_ref(struct io_zcrx_area *area, u32 idx)
+{
+	if (atomic_dec_if_positive(&area->user_refs[idx]) < 0)
+		return;
+	io_zcrx_put_refs(area, idx, 1);
+}
+
+static void io_zcrx_ring_refill(struct io_zcrx_ifq *ifq)
+{
+	struct io_zcrx_area *area = ifq->area;
+	unsigned int mask = ifq->rq_entries - 1;
+	unsigned int entries;
+
+	spin_lock_bh(&ifq->rq_lock);
+	/* pairs with the release store of the tail by the application */
+	entries = smp_load_acquire(&ifq->rq_ring->tail) - ifq->cached_rq_head;
+	entries = min(entries, ifq->rq_entries);
+
+	while (entries--) {
+		struct io_uring_zcrx_rqe *rqe;
+		unsigned long idx;
+		u64 off;
+
+		rqe = &ifq->rqes[ifq->cached_rq_head++ & mask];
+		off = READ_ONCE(rqe->off);
+		if ((off >> IORING_ZCRX_AREA_SHIFT) != area->area_id)
+			continue;
+		idx = (off & ~IORING_ZCRX_AREA_MASK) >> PAGE_SHIFT;
+		if (idx >= area->nr_pages)
+			continue;
+		io_zcrx_put_user_ref(area, idx);
+	}
+
+	smp_store_release(&ifq->rq_ring->head, ifq->cached_rq_head);
+	spin_unlock_bh(&ifq->rq_lock);
+}
+
+static int io_zcrx_get_free(struct io_zcrx_ifq *ifq)
+{
+	int idx;
+
+	idx = __io_zcrx_get_free(ifq->area);
+	if (idx < 0) {
+		io_zcrx_ring_refill(ifq);
+		idx = __io_zcrx_get_free(ifq->area);
+	}
+	return idx;
+}
+
+/*
+ * The pool owns the page until io_pp_zc_release_page(), recycling it for as
+ * long as it likes; buffers posted to the user hold pp_ref_count references
+ * that keep it from doing so while the user reads them.
+ */
+static struct page *io_pp_zc_alloc_page(struct page_pool *pool, gfp_t gfp)
+{
+	struct io_zcrx_ifq *ifq = pool->mp_priv;
+	int idx;
+
+	idx = io_zcrx_get_free(ifq);
+	if (idx < 0)
+		return NULL;
+	return ifq->area->pages[idx];
+}
+
+static void io_pp_zc_release_page(struct page_pool *pool, struct page *page)
+{
+	struct io_zcrx_ifq *ifq = pool->mp_priv;
+	struct io_zcrx_area *area = ifq->area;
+	void *entry;
+
+	entry = xa_load(&area->page_idx, page_to_pfn(page));
+	if (WARN_ON_ONCE(!entry))
+		return;
+
+	io_zcrx_return_page(area, xa_to_value(entry));
+}
+
+static void io_zcrx_ifq_put(struct io_zcrx_ifq *ifq);
+
+static int io_pp_zc_init(struct page_pool *pool)
+{
+	struct io_zcrx_ifq *ifq = pool->mp_priv;
+
+	refcount_inc(&ifq->refs);
+	return 0;
+}
+
+static void io_pp_zc_destroy(struct page_pool *pool)
+{
+	io_zcrx_ifq_put(pool->mp_priv);
+}
+
+static const struct memory_provider_ops io_uring_pp_zc_ops = {
+	.alloc_page		= io_pp_zc_alloc_page,
+	.release_page		= io_pp_zc_release_page,
+	.init			= io_pp_zc_init,
+	.destroy		= io_pp_zc_destroy,
+};
+
+static void io_zcrx_free_area(struct io_zcrx_area *area)
+{
+	unsigned long i;
+
+	if (area->pages) {
+		for (i = 0; i < area->nr_pages; i++)
+			if (area->pages[i])
+				put_page(area->pages[i]);
+	}
+	xa_destroy(&area->page_idx);
+	kvfree(area->pages);
+	kvfree(area->refs);
+	kvfree(area->user_refs);
+	kvfree(area->freelist);
+	kfree(area);
+}
+
+static int io_zcrx_create_area(struct io_zcrx_ifq *ifq,
+			       struct io_uring_zcrx_area_reg *reg)
+{
+	struct io_zcrx_area *area;
+	unsigned long i, nr_pages;
+	int ret;
+
+	if (reg->flags || reg->rq_area_token || reg->__resv1 ||
+	    reg->__resv2[0] || reg->__resv2[1])
+		return -EINVAL;
+	if (!reg->len || !PAGE_ALIGNED(reg->len))
+		return -EINVAL;
+	nr_pages = reg->len >> PAGE_SHIFT;
+	if (nr_pages > IO_ZCRX_AREA_MAX_PAGES)
+		return -EINVAL;
+
+	area = kzalloc(sizeof(*area), GFP_KERNEL);
+	if (!area)
+		return -ENOMEM;
+	area->ifq = ifq;
+	area->nr_pages = nr_pages;
+	xa_init(&area->page_idx);
+	spin_lock_init(&area->freelist_lock);
+	spin_lock_init(&area->copy_lock);
+	area->copy_idx = -1;
+
+	ret = -ENOMEM;
+	area->pages = kvcalloc(nr_pages, sizeof(area->pages[0]), GFP_KERNEL);
+	area->refs = kvcalloc(nr_pages, sizeof(area->refs[0]), GFP_KERNEL);
+	area->user_refs = kvcalloc(nr_pages, sizeof(area->user_refs[0]),
+				   GFP_KERNEL);
+	area->freelist = kvmalloc_array(nr_pages, sizeof(area->freelist[0]),
+					GFP_KERNEL);
+	if (!area->pages || !area->refs || !area->user_refs || !area->freelist)
+		goto err;
+
+	/*
+	 * The page_pool keeps its state in struct page, which anonymous user
+	 * memory can't spare, so the area is allocated here and mapped by
+	 * the application instead, see io_zcrx_mmap_area().
+	 */
+	for (i = 0; i < nr_pages; i++) {
+		area->pages[i] = alloc_page(GFP_KERNEL | __GFP_ZERO);
+		if (!area->pages[i])
+			goto err;
+		ret = xa_err(xa_store(&area->page_idx,
+				      page_to_pfn(area->pages[i]),
+				      xa_mk_value(i), GFP_KERNEL));
+		if (ret)
+			goto err;
+		area->freelist[i] = i;
+	}
+	area->free_count = nr_pages;
+
+	/* single area for now */
+	area->area_id = 0;
+	reg->rq_area_token = (u64)area->area_id << IORING_ZCRX_AREA_SHIFT;
+	ifq->area = area;
+	return 0;
+err:
+	io_zcrx_free_area(area);
+	return ret ?: -ENOMEM;
+}
+
+static int io_allocate_rbuf_ring(struct io_zcrx_ifq *ifq,
+				 struct io_uring_zcrx_ifq_reg *reg)
+{
+	size_t off, size;
+	void *ptr;
+
+	off = sizeof(struct io_uring);
+	size = off + sizeof(struct io_uring_zcrx_rqe) * reg->rq_entries;
+	ptr = io_mem_alloc(size);
+	if (IS_ERR(ptr))
+		return PTR_ERR(ptr);
+
+	ifq->rq_ring = ptr;
+	ifq->rqes = ptr + off;
+	ifq->rq_entries = reg->rq_entries;
+
+	reg->offsets.head = offsetof(struct io_uring, head);
+	reg->offsets.tail = offsetof(struct io_uring, tail);
+	reg->offsets.rqes = off;
+	return 0;
+}
+
+static void io_zcrx_ifq_free(struct io_zcrx_ifq *ifq)
+{
+	if (ifq->area) {
+		if (ifq->user)
+			__io_unaccount_mem(ifq->user, ifq->area->nr_pages);
+		io_zcrx_free_area(ifq->area);
+	}
+	if (ifq->user)
+		free_uid(ifq->user);
+	io_mem_free(ifq->rq_ring);
+	kfree(ifq);
+}
+
+static void io_zcrx_ifq_put(struct io_zcrx_ifq *ifq)
+{
+	if (refcount_dec_and_test(&ifq->refs))
+		io_zcrx_ifq_free(ifq);
+}
+
+static void io_zcrx_ifq_close(struct io_zcrx_ifq *ifq)
+{
+	rtnl_lock();
+	net_mp_close_rxq(ifq->netdev, ifq->if_rxq, ifq);
+	rtnl_unlock();
+	netdev_put(ifq->netdev, &ifq->netdev_tracker);
+	ifq->netdev = NULL;
+}
+
+int io_register_zcrx_ifq(struct io_ring_ctx *ctx,
+			 struct io_uring_zcrx_ifq_reg __user *arg)
+{
+	struct io_uring_zcrx_area_reg __user *uarea;
+	struct io_uring_zcrx_area_reg area;
+	struct io_uring_zcrx_ifq_reg reg;
+	struct io_zcrx_ifq *ifq;
+	int ret;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+	/* offsets are posted in the second half of the CQE */
+	if (!(ctx->flags & IORING_SETUP_CQE32))
+		return -EINVAL;
+	if (ctx->ifq)
+		return -EBUSY;
+
+	if (copy_from_user(&reg, arg, sizeof(reg)))
+		return -EFAULT;
+	if (reg.flags || reg.__resv1 || memchr_inv(&reg.offsets, 0,
+						   sizeof(reg.offsets)) ||
+	    memchr_inv(reg.__resv, 0, sizeof(reg.__resv)))
+		return -EINVAL;
+	uarea = u64_to_user_ptr(reg.area_ptr);
+	if (copy_from_user(&area, uarea, sizeof(area)))
+		return -EFAULT;
+
+	if (!reg.rq_entries)
+		return -EINVAL;
+	if (reg.rq_entries > IO_RQ_MAX_ENTRIES) {
+		if (!(ctx->flags & IORING_SETUP_CLAMP))
+			return -EINVAL;
+		reg.rq_entries = IO_RQ_MAX_ENTRIES;
+	}
+	reg.rq_entries = roundup_pow_of_two(reg.rq_entries);
+
+	ifq = kzalloc(sizeof(*ifq), GFP_KERNEL);
+	if (!ifq)
+		return -ENOMEM;
+	refcount_set(&ifq->refs, 1);
+	spin_lock_init(&ifq->rq_lock);
+
+	ret = io_allocate_rbuf_ring(ifq, &reg);
+	if (ret)
+		goto err;
+
+	ret = io_zcrx_create_area(ifq, &area);
+	if (ret)
+		goto err;
+	if (ctx->user) {
+		ret = __io_account_mem(ctx->user, ifq->area->nr_pages);
+		if (ret) {
+			io_zcrx_free_area(ifq->area);
+			ifq->area = NULL;
+			goto err;
+		}
+		ifq->user = get_uid(ctx->user);
+	}
+
+	ret = -ENODEV;
+	rtnl_lock();
+	ifq->netdev = netdev_get_by_index(current->nsproxy->net_ns, reg.if_idx,
+					  &ifq->netdev_tracker, GFP_KERNEL);
+	if (!ifq->netdev) {
+		rtnl_unlock();
+		goto err;
+	}
+	ifq->if_rxq = reg.if_rxq;
+	ret = net_mp_open_rxq(ifq->netdev, reg.if_rxq, &io_uring_pp_zc_ops,
+			      ifq);
+	rtnl_unlock();
+	if (ret) {
+		netdev_put(ifq->netdev, &ifq->netdev_tracker);
+		goto err;
+	}
+
+	if (copy_to_user(arg, &reg, sizeof(reg)) ||
+	    copy_to_user(uarea, &area, sizeof(area))) {
+		io_zcrx_ifq_close(ifq);
+		ret = -EFAULT;
+		goto err;
+	}
+	/* pairs with smp_load_acquire() in the mmap paths */
+	smp_store_release(&ctx->ifq, ifq);
+	return 0;
+err:
+	io_zcrx_ifq_put(ifq);
+	return ret;
+}
+
+/*
+ * Take back the buffers the user still holds, and the page the copy fallback
+ * was filling, so that the pools can release their pages and go away.
+ */
+static void io_zcrx_scrub(struct io_zcrx_ifq *ifq)
+{
+	struct io_zcrx_area *area = ifq->area;
+	unsigned long i;
+	int nr;
+
+	spin_lock(&area->copy_lock);
+	if (area->copy_idx >= 0)
+		io_zcrx_put_refs(area, area->copy_idx, 1);
+	area->copy_idx = -1;
+	spin_unlock(&area->copy_lock);
+
+	spin_lock_bh(&ifq->rq_lock);
+	for (i = 0; i < area->nr_pages; i++) {
+		nr = atomic_xchg(&area->user_refs[i], 0);
+		if (nr)
+			io_zcrx_put_refs(area, i, nr);
+	}
+	spin_unlock_bh(&ifq->rq_lock);
+}
+
+void io_unregister_zcrx_ifqs(struct io_ring_ctx *ctx)
+{
+	struct io_zcrx_ifq *ifq = ctx->ifq;
+
+	if (!ifq)
+		return;
+
+	ctx->ifq = NULL;
+	io_zcrx_ifq_close(ifq);
+	io_zcrx_scrub(ifq);
+	/* the area stays around until pools using it are destroyed too */
+	io_zcrx_ifq_put(ifq);
+}
+
+int io_zcrx_mmap_area(struct io_ring_ctx *ctx, struct vm_area_struct *vma)
+{
+	struct io_zcrx_ifq *ifq = smp_load_acquire(&ctx->ifq);
+	unsigned long nr_pages = vma_pages(vma);
+
+	if (!ifq)
+		return -EINVAL;
+	if (vma->vm_pgoff != IORING_OFF_ZCRX_AREA >> PAGE_SHIFT ||
+	    nr_pages != ifq->area->nr_pages)
+		return -EINVAL;
+
+	vm_flags_set(vma, VM_DONTEXPAND | VM_DONTDUMP);
+	return vm_insert_pages(vma, vma->vm_start, ifq->area->pages, &nr_pages);
+}
+
+/* Index of @page in the area if it's currently owned by one of our pools */
+static int io_zcrx_page_idx(struct io_zcrx_ifq *ifq, struct page *page)
+{
+	void *entry;
+
+	if (!io_zcrx_page_is_pp(page) || page->pp->mp_priv != ifq)
+		return -1;
+	entry = xa_load(&ifq->area->page_idx, page_to_pfn(page));
+	return entry ? xa_to_value(entry) : -1;
+}
+
+static bool io_zcrx_queue_cqe(struct io_kiocb *req, struct io_zcrx_area *area,
+			      u32 idx, unsigned int off, int len)
+{
+	u64 offset = ((u64)area->area_id << IORING_ZCRX_AREA_SHIFT) |
+		     ((u64)idx << PAGE_SHIFT) | off;
+
+	return io_req_post_cqe32(req, len, IORING_CQE_F_MORE, offset, 0);
+}
+
+/*
+ * Reserve a chunk of up to @len bytes for the copy fallback.  Chunks are
+ * packed into one area page, cache line aligned, and a new page is taken
+ * only once it's full.  Returns the page index, with a reference held for
+ * the chunk, or -1 if the area is exhausted.
+ */
+static int io_zcrx_copy_chunk(struct io_zcrx_ifq *ifq, int len,
+			      unsigned int *off, int *n)
+{
+	struct io_zcrx_area *area = ifq->area;
+	int idx;
+
+	spin_lock(&area->copy_lock);
+	idx = area->copy_idx;
+	if (idx >= 0 && area->copy_off >= PAGE_SIZE) {
+		/* drop the hold taken while the page was being filled */
+		io_zcrx_put_refs(area, idx, 1);
+		idx = -1;
+	}
+	if (idx < 0) {
+		idx = io_zcrx_get_free(ifq);
+		area->copy_idx = idx;
+		if (idx < 0)
+			goto out;
+		atomic_set(&area->refs[idx], 1);
+		area->copy_off = 0;
+	}
+
+	*off = area->copy_off;
+	*n = min_t(int, len, PAGE_SIZE - *off);
+	area->copy_off = ALIGN(*off + *n, SMP_CACHE_BYTES);
+	atomic_inc(&area->refs[idx]);
+out:
+	spin_unlock(&area->copy_lock);
+	return idx;
+}
+
+/* Copy fallback for data that didn't land in the area, e.g. packet heads */
+static ssize_t io_zcrx_copy_skb(struct io_kiocb *req, struct io_zcrx_ifq *ifq,
+				const struct sk_buff *skb, int offset, int len)
+{
+	struct io_zcrx_area *area = ifq->area;
+	ssize_t copied = 0;
+	int ret = 0;
+
+	while (len) {
+		unsigned int off;
+		void *vaddr;
+		int idx, n;
+
+		idx = io_zcrx_copy_chunk(ifq, len, &off, &n);
+		if (idx < 0) {
+			ret = -ENOBUFS;
+			break;
+		}
+
+		vaddr = kmap_local_page(area->pages[idx]);
+		ret = skb_copy_bits(skb, offset, vaddr + off, n);
+		kunmap_local(vaddr);
+		if (ret) {
+			io_zcrx_put_refs(area, idx, 1);
+			break;
+		}
+
+		atomic_inc(&area->user_refs[idx]);
+		if (!io_zcrx_queue_cqe(req, area, idx, off, n)) {
+			io_zcrx_put_user_ref(area, idx);
+			ret = -ENOSPC;
+			break;
+		}
+
+		offset += n;
+		len -= n;
+		copied += n;
+	}
+
+	return copied ? copied : ret;
+}
+
+static int io_zcrx_recv_frag(struct io_kiocb *req, struct io_zcrx_ifq *ifq,
+			     const struct sk_buff *skb, const skb_frag_t *frag,
+			     int skb_off, int off, int len)
+{
+	struct io_zcrx_area *area = ifq->area;
+	int idx;
+
+	off += skb_frag_off(frag);
+	idx = io_zcrx_page_idx(ifq, skb_frag_page(frag));
+	if (idx < 0 || off + len > PAGE_SIZE)
+		return io_zcrx_copy_skb(req, ifq, skb, skb_off, len);
+
+	/*
+	 * The skb holds a pool reference, take one for the user so the pool
+	 * doesn't recycle the page before it's handed back.
+	 */
+	atomic_long_inc(&skb_frag_page(frag)->pp_ref_count);
+	atomic_inc(&area->user_refs[idx]);
+
+	if (!io_zcrx_queue_cqe(req, area, idx, off, len)) {
+		io_zcrx_put_user_ref(area, idx);
+		return -ENOSPC;
+	}
+	return len;
+}
+
+static int __io_zcrx_recv_skb(struct io_zcrx_args *args, struct sk_buff *skb,
+			      unsigned int offset, size_t len)
+{
+	struct io_zcrx_ifq *ifq = args->ifq;
+	struct io_kiocb *req = args->req;
+	struct sk_buff *frag_iter;
+	unsigned int start, start_off = offset;
+	int i, copy, end, off;
+	int ret = 0;
+
+	start = skb_headlen(skb);
+	if (offset < start) {
+		copy = min_t(int, start - offset, len);
+		ret = io_zcrx_copy_skb(req, ifq, skb, offset, copy);
+		if (ret < 0)
+			goto out;
+		offset += ret;
+		len -= ret;
+		if (len == 0 || ret != copy)
+			goto out;
+	}
+
+	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
+		const skb_frag_t *frag;
+
+		if (WARN_ON(start > offset + len))
+			return -EFAULT;
+
+		frag = &skb_shinfo(skb)->frags[i];
+		end = start + skb_frag_size(frag);
+
+		if (offset < end) {
+			copy = min_t(int, end - offset, len);
+			off = offset - start;
+			ret = io_zcrx_recv_frag(req, ifq, skb, frag, offset,
+						off, copy);
+			if (ret < 0)
+				goto out;
+
+			offset += ret;
+			len -= ret;
+			if (len == 0 || ret != copy)
+				goto out;
+		}
+		start = end;
+	}
+
+	skb_walk_frags(skb, frag_iter) {
+		if (WARN_ON(start > offset + len))
+			return -EFAULT;
+
+		end = start + frag_iter->len;
+		if (offset < end) {
+			copy = min_t(int, end - offset, len);
+			off = offset - start;
+			ret = __io_zcrx_recv_skb(args, frag_iter, off, copy);
+			if (ret < 0)
+				goto out;
+
+			offset += ret;
+			len -= ret;
+			if (len == 0 || ret != copy)
+				goto out;
+		}
+		start = end;
+	}
+
+out:
+	if (offset == start_off)
+		return ret;
+	return offset - start_off;
+}
+
+static int io_zcrx_recv_skb(read_descriptor_t *desc, struct sk_buff *skb,
+			    unsigned int offset, size_t len)
+{
+	struct io_zcrx_args *args = desc->arg.data;
+	int ret;
+
+	if (unlikely(args->nr_skbs++ > IO_SKBS_PER_CALL_LIMIT))
+		return -EAGAIN;
+
+	len = min_t(size_t, len, desc->count);
+	ret = __io_zcrx_recv_skb(args, skb, offset, len);
+	if (ret > 0)
+		desc->count -= ret;
+	return ret;
+}
+
+static int io_zcrx_tcp_recvmsg(struct io_kiocb *req, struct io_zcrx_ifq *ifq,
+			       struct sock *sk, int flags,
+			       unsigned issue_flags, unsigned int *outlen)
+{
+	unsigned int len = *outlen;
+	struct io_zcrx_args args = {
+		.req = req,
+		.ifq = ifq,
+	};
+	read_descriptor_t rd_desc = {
+		.count = len ? len : UINT_MAX,
+		.arg.data = &args,
+	};
+	int ret;
+
+	lock_sock(sk);
+	ret = tcp_read_sock(sk, &rd_desc, io_zcrx_recv_skb);
+	if (len && ret > 0)
+		*outlen = len - ret;
+	if (ret <= 0) {
+		if (ret < 0 || sock_flag(sk, SOCK_DONE))
+			goto out;
+		if (sk->sk_err)
+			ret = sock_error(sk);
+		else if (sk->sk_shutdown & RCV_SHUTDOWN)
+			goto out;
+		else if (sk->sk_state == TCP_CLOSE)
+			ret = -ENOTCONN;
+		else
+			ret = -EAGAIN;
+	} else if (unlikely(args.nr_skbs > IO_SKBS_PER_CALL_LIMIT) &&
+		   (issue_flags & IO_URING_F_MULTISHOT)) {
+		ret = IOU_REQUEUE;
+	} else if (sock_flag(sk, SOCK_DONE)) {
+		/* keep going until the 0 return for EOF is seen */
+		if (issue_flags & IO_URING_F_MULTISHOT)
+			ret = IOU_REQUEUE;
+		else
+			ret = -EAGAIN;
+	}
+out:
+	release_sock(sk);
+	return ret;
+}
+
+int io_zcrx_recv(struct io_kiocb *req, struct io_zcrx_ifq *ifq,
+		 struct socket *sock, unsigned int flags,
+		 unsigned issue_flags, unsigned int *len)
+{
+	struct sock *sk = sock->sk;
+	const struct proto *prot = READ_ONCE(sk->sk_prot);
+
+	if (prot->recvmsg != tcp_recvmsg)
+		return -EPROTONOSUPPORT;
+
+	sock_rps_record_flow(sk);
+	return io_zcrx_tcp_recvmsg(req, ifq, sk, flags, issue_flags, len);
+}
+
+#endif
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef IOU_ZC_RX_H
+#define IOU_ZC_RX_H
+
+#include <linux/io_uring_types.h>
+#include <linux/netdevice.h>
+#include <linux/xarray.h>
+
+struct io_zcrx_area {
+	struct io_zcrx_ifq	*ifq;
+	struct page		**pages;
+	unsigned long		nr_pages;
+	u16			area_id;
+
+	/* pfn -> page index, to recognise pages coming back from the pool */
+	struct xarray		page_idx;
+	/*
+	 * per page, references to pages used by the copy fallback: one per
+	 * chunk posted and one while the page is being filled.  Pages owned
+	 * by a page_pool are tracked by their pp_ref_count instead.
+	 */
+	atomic_t		*refs;
+	/* per page, buffers posted to the user and not returned yet */
+	atomic_t		*user_refs;
+
+	spinlock_t		freelist_lock;
+	u32			free_count;
+	u32			*freelist;
+
+	/* page the copy fallback packs chunks into, -1 if none */
+	spinlock_t		copy_lock;
+	int			copy_idx;
+	unsigned int		copy_off;
+};
+
+struct io_zcrx_ifq {
+	struct io_zcrx_area		*area;
+	/* one for the ring, one for each page_pool using the queue */
+	refcount_t			refs;
+	struct user_struct		*user;
+
+	spinlock_t			rq_lock;
+	struct io_uring			*rq_ring;
+	struct io_uring_zcrx_rqe	*rqes;
+	u32				rq_entries;
+	u32				cached_rq_head;
+
+	u32				if_rxq;
+	struct net_device		*netdev;
+	netdevice_tracker		netdev_tracker;
+};
+
+#if defined(CONFIG_PAGE_POOL) && defined(CONFIG_INET)
+int io_register_zcrx_ifq(struct io_ring_ctx *ctx,
+			 struct io_uring_zcrx_ifq_reg __user *arg);
+void io_unregister_zcrx_ifqs(struct io_ring_ctx *ctx);
+int io_zcrx_mmap_area(struct io_ring_ctx *ctx, struct vm_area_struct *vma);
+int io_zcrx_recv(struct io_kiocb *req, struct io_zcrx_ifq *ifq,
+		 struct socket *sock, unsigned int flags,
+		 unsigned issue_flags, unsigned int *len);
+#else
+static inline int io_register_zcrx_ifq(struct io_ring_ctx *ctx,
+				       struct io_uring_zcrx_ifq_reg __user *arg)
+{
+	return -EOPNOTSUPP;
+}
+static inline void io_unregister_zcrx_ifqs(struct io_ring_ctx *ctx)
+{
+}
+static inline int io_zcrx_mmap_area(struct io_ring_ctx *ctx,
+				    struct vm_area_struct *vma)
+{
+	return -EINVAL;
+}
+static inline int io_zcrx_recv(struct io_kiocb *req, struct io_zcrx_ifq *ifq,
+			       struct socket *sock, unsigned int flags,
+			       unsigned issue_flags, unsigned int *len)
+{
+	return -EOPNOTSUPP;
+}
+#endif
+
+#endif
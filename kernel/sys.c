@@ -16,6 +16,7 @@
 #include <linux/fs.h>
 #include <linux/kmod.h>
 #include <linux/ksm.h>
+#include <linux/khugepaged.h>
 #include <linux/perf_event.h>
 #include <linux/resource.h>
 #include <linux/kernel.h>
@@ -2588,6 +2589,23 @@ SYSCALL_DEFINE5(prctl, int, option, unsigned long, arg2, unsigned long, arg3,
 			clear_bit(MMF_DISABLE_THP, &me->mm->flags);
 		mmap_write_unlock(me->mm);
 		break;
+	case PR_GET_THP_COLLAPSE_PRIORITY:
+		if (arg2 || arg3 || arg4 || arg5)
+			return -EINVAL;
+		error = test_bit(MMF_THP_COLLAPSE_PRIO, &me->mm->flags) ?
+			PR_THP_COLLAPSE_PRIO_HIGH : PR_THP_COLLAPSE_PRIO_NORMAL;
+		break;
+	case PR_SET_THP_COLLAPSE_PRIORITY:
+		if (arg3 || arg4 || arg5)
+			return -EINVAL;
+		if (arg2 == PR_THP_COLLAPSE_PRIO_HIGH)
+			set_bit(MMF_THP_COLLAPSE_PRIO, &me->mm->flags);
+		else if (arg2 == PR_THP_COLLAPSE_PRIO_NORMAL)
+			clear_bit(MMF_THP_COLLAPSE_PRIO, &me->mm->flags);
+		else
+			return -EINVAL;
+		khugepaged_update_priority(me->mm);
+		break;
 	case PR_MPX_ENABLE_MANAGEMENT:
 	case PR_MPX_DISABLE_MANAGEMENT:
 		/* No longer implemented: */
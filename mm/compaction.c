@@ -1756,6 +1756,11 @@ static int sysctl_compact_unevictable_allowed __read_mostly = CONFIG_COMPACT_UNE
  * background. It takes values in the range [0, 100].
  */
 static unsigned int __read_mostly sysctl_compaction_proactiveness = 20;
+/*
+ * Number of workers that proactive compaction splits a zone's PFN range
+ * across. 1 keeps compaction on the kcompactd thread itself.
+ */
+static unsigned int __read_mostly sysctl_compaction_proactive_workers = 1;
 static int sysctl_extfrag_threshold = 500;
 
 static inline void
@@ -2351,6 +2356,7 @@ compact_zone(struct compact_control *cc, struct capture_control *capc)
 	 */
 	cc->total_migrate_scanned = 0;
 	cc->total_free_scanned = 0;
+	cc->total_migrated = 0;
 	cc->nr_migratepages = 0;
 	cc->nr_freepages = 0;
 	INIT_LIST_HEAD(&cc->freepages);
@@ -2378,6 +2384,10 @@ compact_zone(struct compact_control *cc, struct capture_control *capc)
 	 */
 	cc->fast_start_pfn = 0;
 	if (cc->whole_zone) {
+		if (cc->range_end_pfn) {
+			start_pfn = max(start_pfn, cc->range_start_pfn);
+			end_pfn = min(end_pfn, cc->range_end_pfn);
+		}
 		cc->migrate_pfn = start_pfn;
 		cc->free_pfn = pageblock_start_pfn(end_pfn - 1);
 	} else {
@@ -2462,6 +2472,7 @@ compact_zone(struct compact_control *cc, struct capture_control *capc)
 				MR_COMPACTION, &nr_succeeded);
 
 		trace_mm_compaction_migratepages(cc, nr_succeeded);
+		cc->total_migrated += nr_succeeded;
 
 		/* All pages were either migrated or will be released */
 		cc->nr_migratepages = 0;
@@ -2693,6 +2704,94 @@ enum compact_result try_to_compact_pages(gfp_t gfp_mask, unsigned int order,
 	return rc;
 }
 
+/*
+ * Parallel proactive compaction: a zone large enough to be worth it is
+ * split into pageblock aligned ranges of at least
+ * PROACTIVE_WORKER_MIN_PAGEBLOCKS each, and every range is compacted by
+ * its own work item on kcompactd_wq, with both scanners confined to it.
+ */
+#define PROACTIVE_WORKER_MIN_PAGEBLOCKS	512
+#define PROACTIVE_WORKERS_MAX		64
+
+static struct workqueue_struct *kcompactd_wq;
+
+struct proactive_compact_work {
+	struct work_struct work;
+	struct zone *zone;
+	unsigned long start_pfn;
+	unsigned long end_pfn;
+};
+
+static void proactive_compact_range(struct work_struct *work)
+{
+	struct proactive_compact_work *pcw =
+		container_of(work, struct proactive_compact_work, work);
+	struct compact_control cc = {
+		.order = -1,
+		.mode = MIGRATE_SYNC_LIGHT,
+		.ignore_skip_hint = true,
+		.whole_zone = true,
+		.gfp_mask = GFP_KERNEL,
+		.proactive_compaction = true,
+		.zone = pcw->zone,
+		.range_start_pfn = pcw->start_pfn,
+		.range_end_pfn = pcw->end_pfn,
+	};
+
+	compact_zone(&cc, NULL);
+
+	count_compact_event(KCOMPACTD_WORKER_RUN);
+	count_compact_events(KCOMPACTD_WORKER_MIGRATE_SCANNED,
+			     cc.total_migrate_scanned);
+	count_compact_events(KCOMPACTD_WORKER_FREE_SCANNED,
+			     cc.total_free_scanned);
+	count_compact_events(KCOMPACTD_WORKER_MIGRATED, cc.total_migrated);
+	count_compact_events(KCOMPACTD_MIGRATE_SCANNED,
+			     cc.total_migrate_scanned);
+	count_compact_events(KCOMPACTD_FREE_SCANNED, cc.total_free_scanned);
+}
+
+/*
+ * Compact @zone with up to sysctl_compaction_proactive_workers workers.
+ * Returns false if the zone should be compacted serially instead.
+ */
+static bool proactive_compact_zone_parallel(struct zone *zone)
+{
+	unsigned long start_pfn = pageblock_start_pfn(zone->zone_start_pfn);
+	unsigned long end_pfn = zone_end_pfn(zone);
+	unsigned long nr_blocks, chunk;
+	struct proactive_compact_work *works;
+	unsigned int nr_workers, i;
+
+	nr_workers = READ_ONCE(sysctl_compaction_proactive_workers);
+	nr_blocks = (end_pfn - start_pfn) >> pageblock_order;
+	nr_workers = min_t(unsigned long, nr_workers,
+			   nr_blocks / PROACTIVE_WORKER_MIN_PAGEBLOCKS);
+	if (nr_workers <= 1 || !kcompactd_wq)
+		return false;
+
+	works = kcalloc(nr_workers, sizeof(*works), GFP_KERNEL);
+	if (!works)
+		return false;
+
+	chunk = DIV_ROUND_UP(nr_blocks, nr_workers) << pageblock_order;
+	for (i = 0; i < nr_workers; i++) {
+		struct proactive_compact_work *pcw = &works[i];
+
+		pcw->zone = zone;
+		pcw->start_pfn = start_pfn + i * chunk;
+		pcw->end_pfn = min(pcw->start_pfn + chunk, end_pfn);
+		INIT_WORK(&pcw->work, proactive_compact_range);
+		queue_work_node(zone_to_nid(zone), kcompactd_wq, &pcw->work);
+	}
+
+	for (i = 0; i < nr_workers; i++)
+		flush_work(&works[i].work);
+
+	kfree(works);
+	return true;
+}
+
 /*
  * Compact all zones within a node till each zone's fragmentation score
  * reaches within proactive compaction thresholds (as determined by the
@@ -2720,6 +2819,9 @@ static void proactive_compact_node(pg_data_t *pgdat)
 		if (!populated_zone(zone))
 			continue;
 
+		if (proactive_compact_zone_parallel(zone))
+			continue;
+
 		cc.zone = zone;
 
 		compact_zone(&cc, NULL);
@@ -3115,6 +3217,8 @@ static int proc_dointvec_minmax_warn_RT_change(struct ctl_table *table,
 	return ret;
 }
 
+static unsigned int proactive_workers_max = PROACTIVE_WORKERS_MAX;
+
 static struct ctl_table vm_compaction[] = {
 	{
 		.procname	= "compact_memory",
@@ -3132,6 +3236,15 @@ static struct ctl_table vm_compaction[] = {
 		.extra1		= SYSCTL_ZERO,
 		.extra2		= SYSCTL_ONE_HUNDRED,
 	},
+	{
+		.procname	= "compaction_proactive_workers",
+		.data		= &sysctl_compaction_proactive_workers,
+		.maxlen		= sizeof(sysctl_compaction_proactive_workers),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec_minmax,
+		.extra1		= SYSCTL_ONE,
+		.extra2		= &proactive_workers_max,
+	},
 	{
 		.procname	= "extfrag_threshold",
 		.data		= &sysctl_extfrag_threshold,
@@ -3166,6 +3279,9 @@ static int __init kcompactd_init(void)
 		return ret;
 	}
 
+	/* Without the pool, proactive compaction just stays serial */
+	kcompactd_wq = alloc_workqueue("kcompactd_wq", WQ_UNBOUND, 0);
+
 	for_each_node_state(nid, N_MEMORY)
 		kcompactd_run(nid);
 	register_sysctl_init("vm", vm_compaction);
@@ -322,6 +322,9 @@ struct damos *damon_new_scheme(struct damos_access_pattern *pattern,
 	scheme->pattern = *pattern;
 	scheme->action = action;
 	INIT_LIST_HEAD(&scheme->filters);
+	scheme->migrate_rate_limit = 0;
+	scheme->migrate_window_start = jiffies;
+	scheme->migrate_window_sz = 0;
 	scheme->stat = (struct damos_stat){};
 	INIT_LIST_HEAD(&scheme->list);
 
@@ -7,6 +7,8 @@
 
 #define pr_fmt(fmt) "damon-pa: " fmt
 
+#include <linux/memory-tiers.h>
+#include <linux/migrate.h>
 #include <linux/mmu_notifier.h>
 #include <linux/page_idle.h>
 #include <linux/pagemap.h>
@@ -292,6 +294,110 @@ static unsigned long damon_pa_deactivate_pages(struct damon_region *r,
 	return damon_pa_mark_accessed_or_deactivate(r, s, false);
 }
 
+/*
+ * Charge @sz bytes against the migration rate limit of @s.  Returns false if
+ * @s already used up its share of the current one second window.  The first
+ * folio of a window is always allowed so that a limit smaller than a huge
+ * page does not stall the scheme forever.
+ */
+static bool damos_pa_migrate_charge(struct damos *s, unsigned long sz)
+{
+	unsigned long limit;
+
+	if (!s->migrate_rate_limit)
+		return true;
+
+	if (time_after_eq(jiffies, s->migrate_window_start + HZ)) {
+		s->migrate_window_start = jiffies;
+		s->migrate_window_sz = 0;
+	}
+
+	limit = min(s->migrate_rate_limit, ULONG_MAX >> 20) << 20;
+	if (s->migrate_window_sz && s->migrate_window_sz + sz > limit)
+		return false;
+	s->migrate_window_sz += sz;
+	return true;
+}
+
+static unsigned int damon_pa_migrate_folio_list(struct list_head *folio_list,
+		int target_nid)
+{
+	unsigned int nr_succeeded = 0;
+	struct migration_target_control mtc = {
+		/*
+		 * Allocate from the target node only, and fail quickly and
+		 * quietly.  The folios just stay where they are in that case.
+		 */
+		.gfp_mask = (GFP_HIGHUSER_MOVABLE & ~__GFP_RECLAIM) |
+			__GFP_NOWARN | __GFP_NOMEMALLOC | GFP_NOWAIT |
+			__GFP_THISNODE,
+		.nid = target_nid,
+	};
+
+	if (list_empty(folio_list))
+		return 0;
+
+	migrate_pages(folio_list, alloc_migration_target, NULL,
+		      (unsigned long)&mtc, MIGRATE_ASYNC, MR_DAMON,
+		      &nr_succeeded);
+	putback_movable_pages(folio_list);
+	return nr_succeeded;
+}
+
+/*
+ * Move the folios of @r one step up (@promote) or down the memory tier
+ * hierarchy.  Physical regions rarely span nodes, so folios are batched
+ * until the target node changes.
+ */
+static unsigned long damon_pa_migrate(struct damon_region *r, struct damos *s,
+		bool promote)
+{
+	unsigned long addr, applied = 0;
+	int nid = NUMA_NO_NODE, target_nid = NUMA_NO_NODE;
+	LIST_HEAD(folio_list);
+
+	for (addr = r->ar.start; addr < r->ar.end; addr += PAGE_SIZE) {
+		struct folio *folio = damon_get_folio(PHYS_PFN(addr));
+
+		if (!folio)
+			continue;
+
+		if (damos_pa_filter_out(s, folio))
+			goto put_folio;
+
+		if (folio_nid(folio) != nid) {
+			applied += damon_pa_migrate_folio_list(&folio_list,
+							       target_nid);
+			nid = folio_nid(folio);
+			target_nid = promote ? next_promotion_node(nid) :
+					       next_demotion_node(nid);
+		}
+		if (target_nid == NUMA_NO_NODE)
+			goto put_folio;
+
+		if (!damos_pa_migrate_charge(s, folio_size(folio))) {
+			folio_put(folio);
+			break;
+		}
+		if (!folio_isolate_lru(folio))
+			goto put_folio;
+		if (folio_test_unevictable(folio)) {
+			folio_putback_lru(folio);
+			goto put_folio;
+		}
+		node_stat_mod_folio(folio,
+				NR_ISOLATED_ANON + folio_is_file_lru(folio),
+				folio_nr_pages(folio));
+		list_add(&folio->lru, &folio_list);
+put_folio:
+		folio_put(folio);
+	}
+	applied += damon_pa_migrate_folio_list(&folio_list, target_nid);
+	count_vm_events(promote ? PGPROMOTE_DAMON : PGDEMOTE_DAMON, applied);
+	cond_resched();
+	return applied * PAGE_SIZE;
+}
+
 static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 		struct damon_target *t, struct damon_region *r,
 		struct damos *scheme)
@@ -303,6 +409,10 @@ static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 		return damon_pa_mark_accessed(r, scheme);
 	case DAMOS_LRU_DEPRIO:
 		return damon_pa_deactivate_pages(r, scheme);
+	case DAMOS_PROMOTE:
+		return damon_pa_migrate(r, scheme, true);
+	case DAMOS_DEMOTE:
+		return damon_pa_migrate(r, scheme, false);
 	case DAMOS_STAT:
 		break;
 	default:
@@ -323,6 +433,10 @@ static int damon_pa_scheme_score(struct damon_ctx *context,
 		return damon_hot_score(context, r, scheme);
 	case DAMOS_LRU_DEPRIO:
 		return damon_cold_score(context, r, scheme);
+	case DAMOS_PROMOTE:
+		return damon_hot_score(context, r, scheme);
+	case DAMOS_DEMOTE:
+		return damon_cold_score(context, r, scheme);
 	default:
 		break;
 	}
@@ -1032,6 +1032,7 @@ static const struct kobj_type damon_sysfs_access_pattern_ktype = {
 struct damon_sysfs_scheme {
 	struct kobject kobj;
 	enum damos_action action;
+	unsigned long migrate_rate_limit_mbps;
 	struct damon_sysfs_access_pattern *access_pattern;
 	struct damon_sysfs_quotas *quotas;
 	struct damon_sysfs_watermarks *watermarks;
@@ -1049,6 +1050,8 @@ static const char * const damon_sysfs_damos_action_strs[] = {
 	"nohugepage",
 	"lru_prio",
 	"lru_deprio",
+	"promote",
+	"demote",
 	"stat",
 };
 
@@ -1062,6 +1065,7 @@ static struct damon_sysfs_scheme *damon_sysfs_scheme_alloc(
 		return NULL;
 	scheme->kobj = (struct kobject){};
 	scheme->action = action;
+	scheme->migrate_rate_limit_mbps = 0;
 	return scheme;
 }
 
@@ -1265,6 +1269,27 @@ static ssize_t action_store(struct kobject *kobj, struct kobj_attribute *attr,
 	return -EINVAL;
 }
 
+static ssize_t migrate_rate_limit_mbps_show(struct kobject *kobj,
+		struct kobj_attribute *attr, char *buf)
+{
+	struct damon_sysfs_scheme *scheme = container_of(kobj,
+			struct damon_sysfs_scheme, kobj);
+
+	return sysfs_emit(buf, "%lu\n", scheme->migrate_rate_limit_mbps);
+}
+
+static ssize_t migrate_rate_limit_mbps_store(struct kobject *kobj,
+		struct kobj_attribute *attr, const char *buf, size_t count)
+{
+	struct damon_sysfs_scheme *scheme = container_of(kobj,
+			struct damon_sysfs_scheme, kobj);
+	int err = kstrtoul(buf, 0, &scheme->migrate_rate_limit_mbps);
+
+	if (err)
+		return -EINVAL;
+	return count;
+}
+
 static void damon_sysfs_scheme_release(struct kobject *kobj)
 {
 	kfree(container_of(kobj, struct damon_sysfs_scheme, kobj));
@@ -1273,8 +1298,12 @@ static void damon_sysfs_scheme_release(struct kobject *kobj)
 static struct kobj_attribute damon_sysfs_scheme_action_attr =
 		__ATTR_RW_MODE(action, 0600);
 
+static struct kobj_attribute damon_sysfs_scheme_migrate_rate_limit_mbps_attr =
+		__ATTR_RW_MODE(migrate_rate_limit_mbps, 0600);
+
 static struct attribute *damon_sysfs_scheme_attrs[] = {
 	&damon_sysfs_scheme_action_attr.attr,
+	&damon_sysfs_scheme_migrate_rate_limit_mbps_attr.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(damon_sysfs_scheme);
@@ -1516,6 +1545,7 @@ static struct damos *damon_sysfs_mk_scheme(
 			&wmarks);
 	if (!scheme)
 		return NULL;
+	scheme->migrate_rate_limit = sysfs_scheme->migrate_rate_limit_mbps;
 
 	err = damon_sysfs_set_scheme_filters(scheme, sysfs_filters);
 	if (err) {
@@ -1543,6 +1573,7 @@ static void damon_sysfs_update_scheme(struct damos *scheme,
 	scheme->pattern.max_age_region = access_pattern->age->max;
 
 	scheme->action = sysfs_scheme->action;
+	scheme->migrate_rate_limit = sysfs_scheme->migrate_rate_limit_mbps;
 
 	scheme->quota.ms = sysfs_quotas->ms;
 	scheme->quota.sz = sysfs_quotas->sz;
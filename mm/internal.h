@@ -491,6 +491,13 @@ struct compact_control {
 	struct zone *zone;
 	unsigned long total_migrate_scanned;
 	unsigned long total_free_scanned;
+	unsigned long total_migrated;	/* Pages successfully migrated */
+	/*
+	 * If range_end_pfn is set, a whole_zone compaction only scans
+	 * [range_start_pfn, range_end_pfn) of the zone.
+	 */
+	unsigned long range_start_pfn;
+	unsigned long range_end_pfn;
 	unsigned short fast_search_fail;/* failures to use free list searches */
 	short search_order;		/* order to start a fast search at */
 	const gfp_t gfp_mask;		/* gfp mask of a direct compactor */
@@ -68,8 +68,11 @@ static DEFINE_MUTEX(khugepaged_mutex);
 
 /* default scan 8*512 pte (or vmas) every 30 second */
 static unsigned int khugepaged_pages_to_scan __read_mostly;
+/* budget spent on PR_THP_COLLAPSE_PRIO_HIGH mms before the others */
+static unsigned int khugepaged_prio_pages_to_scan __read_mostly;
 static unsigned int khugepaged_pages_collapsed;
 static unsigned int khugepaged_full_scans;
+static unsigned int khugepaged_prio_full_scans;
 static unsigned int khugepaged_scan_sleep_millisecs __read_mostly = 10000;
 /* during fragmentation poll the hugepage allocator once every minute */
 static unsigned int khugepaged_alloc_sleep_millisecs __read_mostly = 60000;
@@ -107,11 +110,13 @@ struct collapse_control {
 /**
  * struct khugepaged_mm_slot - khugepaged information per mm that is being scanned
  * @slot: hash lookup from mm to mm_slot
+ * @high_prio: the slot is queued on khugepaged_prio_scan
  * @nr_pte_mapped_thp: number of pte mapped THP
  * @pte_mapped_thp: address array corresponding pte mapped THP
  */
 struct khugepaged_mm_slot {
 	struct mm_slot slot;
+	bool high_prio;
 
 	/* pte-mapped THP in this mm */
 	int nr_pte_mapped_thp;
@@ -123,17 +128,27 @@ struct khugepaged_mm_slot {
  * @mm_head: the head of the mm list to scan
  * @mm_slot: the current mm_slot we are scanning
  * @address: the next address inside that to be scanned
+ * @full_scans: bumped each time the cursor wraps around @mm_head
  *
- * There is only the one khugepaged_scan instance of this cursor structure.
+ * There are two instances of this cursor structure: khugepaged_prio_scan
+ * for mms that asked for PR_THP_COLLAPSE_PRIO_HIGH, which is serviced
+ * first on every pass, and khugepaged_scan for everybody else.
  */
 struct khugepaged_scan {
 	struct list_head mm_head;
 	struct khugepaged_mm_slot *mm_slot;
 	unsigned long address;
+	unsigned int *full_scans;
 };
 
 static struct khugepaged_scan khugepaged_scan = {
 	.mm_head = LIST_HEAD_INIT(khugepaged_scan.mm_head),
+	.full_scans = &khugepaged_full_scans,
+};
+
+static struct khugepaged_scan khugepaged_prio_scan = {
+	.mm_head = LIST_HEAD_INIT(khugepaged_prio_scan.mm_head),
+	.full_scans = &khugepaged_prio_full_scans,
 };
 
 #ifdef CONFIG_SYSFS
@@ -233,6 +248,39 @@ static ssize_t full_scans_show(struct kobject *kobj,
 static struct kobj_attribute full_scans_attr =
 	__ATTR_RO(full_scans);
 
+static ssize_t prio_pages_to_scan_show(struct kobject *kobj,
+				       struct kobj_attribute *attr,
+				       char *buf)
+{
+	return sysfs_emit(buf, "%u\n", khugepaged_prio_pages_to_scan);
+}
+static ssize_t prio_pages_to_scan_store(struct kobject *kobj,
+					struct kobj_attribute *attr,
+					const char *buf, size_t count)
+{
+	unsigned int pages;
+	int err;
+
+	err = kstrtouint(buf, 10, &pages);
+	if (err || !pages)
+		return -EINVAL;
+
+	khugepaged_prio_pages_to_scan = pages;
+
+	return count;
+}
+static struct kobj_attribute prio_pages_to_scan_attr =
+	__ATTR_RW(prio_pages_to_scan);
+
+static ssize_t prio_full_scans_show(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    char *buf)
+{
+	return sysfs_emit(buf, "%u\n", khugepaged_prio_full_scans);
+}
+static struct kobj_attribute prio_full_scans_attr =
+	__ATTR_RO(prio_full_scans);
+
 static ssize_t defrag_show(struct kobject *kobj,
 			   struct kobj_attribute *attr, char *buf)
 {
@@ -341,6 +389,8 @@ static struct attribute *khugepaged_attr[] = {
 	&pages_to_scan_attr.attr,
 	&pages_collapsed_attr.attr,
 	&full_scans_attr.attr,
+	&prio_pages_to_scan_attr.attr,
+	&prio_full_scans_attr.attr,
 	&scan_sleep_millisecs_attr.attr,
 	&alloc_sleep_millisecs_attr.attr,
 	NULL,
@@ -399,6 +449,7 @@ int __init khugepaged_init(void)
 		return -ENOMEM;
 
 	khugepaged_pages_to_scan = HPAGE_PMD_NR * 8;
+	khugepaged_prio_pages_to_scan = HPAGE_PMD_NR * 8;
 	khugepaged_max_ptes_none = HPAGE_PMD_NR - 1;
 	khugepaged_max_ptes_swap = HPAGE_PMD_NR / 8;
 	khugepaged_max_ptes_shared = HPAGE_PMD_NR / 2;
@@ -416,6 +467,19 @@ static inline int hpage_collapse_test_exit(struct mm_struct *mm)
 	return atomic_read(&mm->mm_users) == 0;
 }
 
+static inline bool khugepaged_has_mm(void)
+{
+	return !list_empty(&khugepaged_scan.mm_head) ||
+	       !list_empty(&khugepaged_prio_scan.mm_head);
+}
+
+static inline struct list_head *
+khugepaged_slot_head(struct khugepaged_mm_slot *mm_slot)
+{
+	return mm_slot->high_prio ? &khugepaged_prio_scan.mm_head :
+				    &khugepaged_scan.mm_head;
+}
+
 void __khugepaged_enter(struct mm_struct *mm)
 {
 	struct khugepaged_mm_slot *mm_slot;
@@ -441,8 +505,9 @@ void __khugepaged_enter(struct mm_struct *mm)
 	 * Insert just behind the scanning cursor, to let the area settle
 	 * down a little.
 	 */
-	wakeup = list_empty(&khugepaged_scan.mm_head);
-	list_add_tail(&slot->mm_node, &khugepaged_scan.mm_head);
+	wakeup = !khugepaged_has_mm();
+	mm_slot->high_prio = test_bit(MMF_THP_COLLAPSE_PRIO, &mm->flags);
+	list_add_tail(&slot->mm_node, khugepaged_slot_head(mm_slot));
 	spin_unlock(&khugepaged_mm_lock);
 
 	mmgrab(mm);
@@ -450,6 +515,45 @@ void __khugepaged_enter(struct mm_struct *mm)
 		wake_up_interruptible(&khugepaged_wait);
 }
 
+/*
+ * Move @mm_slot to the list matching its mm's collapse priority.  Must not
+ * be called on a slot that a scan cursor currently points at.
+ */
+static void khugepaged_requeue_mm_slot(struct khugepaged_mm_slot *mm_slot)
+{
+	bool high_prio = test_bit(MMF_THP_COLLAPSE_PRIO,
+				  &mm_slot->slot.mm->flags);
+
+	lockdep_assert_held(&khugepaged_mm_lock);
+
+	if (mm_slot->high_prio == high_prio)
+		return;
+	mm_slot->high_prio = high_prio;
+	list_move_tail(&mm_slot->slot.mm_node, khugepaged_slot_head(mm_slot));
+}
+
+/*
+ * Called after PR_SET_THP_COLLAPSE_PRIORITY changed the priority of @mm.  If
+ * khugepaged is in the middle of scanning @mm the slot is moved once the
+ * cursor leaves it instead.
+ */
+void khugepaged_update_priority(struct mm_struct *mm)
+{
+	struct khugepaged_mm_slot *mm_slot;
+	struct mm_slot *slot;
+
+	if (!test_bit(MMF_VM_HUGEPAGE, &mm->flags))
+		return;
+
+	spin_lock(&khugepaged_mm_lock);
+	slot = mm_slot_lookup(mm_slots_hash, mm);
+	mm_slot = mm_slot_entry(slot, struct khugepaged_mm_slot, slot);
+	if (mm_slot && khugepaged_scan.mm_slot != mm_slot &&
+	    khugepaged_prio_scan.mm_slot != mm_slot)
+		khugepaged_requeue_mm_slot(mm_slot);
+	spin_unlock(&khugepaged_mm_lock);
+}
+
 void khugepaged_enter_vma(struct vm_area_struct *vma,
 			  unsigned long vm_flags)
 {
@@ -469,7 +573,8 @@ void __khugepaged_exit(struct mm_struct *mm)
 	spin_lock(&khugepaged_mm_lock);
 	slot = mm_slot_lookup(mm_slots_hash, mm);
 	mm_slot = mm_slot_entry(slot, struct khugepaged_mm_slot, slot);
-	if (mm_slot && khugepaged_scan.mm_slot != mm_slot) {
+	if (mm_slot && khugepaged_scan.mm_slot != mm_slot &&
+	    khugepaged_prio_scan.mm_slot != mm_slot) {
 		hash_del(&slot->hash);
 		list_del(&slot->mm_node);
 		free = 1;
@@ -1075,8 +1180,10 @@ static int alloc_charge_hpage(struct page **hpage, struct mm_struct *mm,
 	int node = hpage_collapse_find_target_node(cc);
 	struct folio *folio;
 
-	if (!hpage_collapse_alloc_page(hpage, gfp, node, &cc->alloc_nmask))
+	if (!hpage_collapse_alloc_page(hpage, gfp, node, &cc->alloc_nmask)) {
+		count_memcg_event_mm(mm, THP_COLLAPSE_ALLOC_FAILED);
 		return SCAN_ALLOC_HUGE_PAGE_FAIL;
+	}
 
 	folio = page_folio(*hpage);
 	if (unlikely(mem_cgroup_charge(folio, mm, gfp))) {
@@ -2440,7 +2547,8 @@ static bool khugepaged_add_pte_mapped_thp(struct mm_struct *mm,
 }
 #endif
 
-static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
+static unsigned int khugepaged_scan_mm_slot(struct khugepaged_scan *scan,
+					    unsigned int pages, int *result,
 					    struct collapse_control *cc)
 	__releases(&khugepaged_mm_lock)
 	__acquires(&khugepaged_mm_lock)
@@ -2456,15 +2564,15 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 	lockdep_assert_held(&khugepaged_mm_lock);
 	*result = SCAN_FAIL;
 
-	if (khugepaged_scan.mm_slot) {
-		mm_slot = khugepaged_scan.mm_slot;
+	if (scan->mm_slot) {
+		mm_slot = scan->mm_slot;
 		slot = &mm_slot->slot;
 	} else {
-		slot = list_entry(khugepaged_scan.mm_head.next,
+		slot = list_entry(scan->mm_head.next,
 				     struct mm_slot, mm_node);
 		mm_slot = mm_slot_entry(slot, struct khugepaged_mm_slot, slot);
-		khugepaged_scan.address = 0;
-		khugepaged_scan.mm_slot = mm_slot;
+		scan->address = 0;
+		scan->mm_slot = mm_slot;
 	}
 	spin_unlock(&khugepaged_mm_lock);
 	khugepaged_collapse_pte_mapped_thps(mm_slot);
@@ -2482,7 +2590,7 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 	if (unlikely(hpage_collapse_test_exit(mm)))
 		goto breakouterloop;
 
-	vma_iter_init(&vmi, mm, khugepaged_scan.address);
+	vma_iter_init(&vmi, mm, scan->address);
 	for_each_vma(vmi, vma) {
 		unsigned long hstart, hend;
 
@@ -2498,36 +2606,36 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 		}
 		hstart = round_up(vma->vm_start, HPAGE_PMD_SIZE);
 		hend = round_down(vma->vm_end, HPAGE_PMD_SIZE);
-		if (khugepaged_scan.address > hend)
+		if (scan->address > hend)
 			goto skip;
-		if (khugepaged_scan.address < hstart)
-			khugepaged_scan.address = hstart;
-		VM_BUG_ON(khugepaged_scan.address & ~HPAGE_PMD_MASK);
+		if (scan->address < hstart)
+			scan->address = hstart;
+		VM_BUG_ON(scan->address & ~HPAGE_PMD_MASK);
 
-		while (khugepaged_scan.address < hend) {
+		while (scan->address < hend) {
 			bool mmap_locked = true;
 
 			cond_resched();
 			if (unlikely(hpage_collapse_test_exit(mm)))
 				goto breakouterloop;
 
-			VM_BUG_ON(khugepaged_scan.address < hstart ||
-				  khugepaged_scan.address + HPAGE_PMD_SIZE >
+			VM_BUG_ON(scan->address < hstart ||
+				  scan->address + HPAGE_PMD_SIZE >
 				  hend);
 			if (IS_ENABLED(CONFIG_SHMEM) && vma->vm_file) {
 				struct file *file = get_file(vma->vm_file);
 				pgoff_t pgoff = linear_page_index(vma,
-						khugepaged_scan.address);
+						scan->address);
 
 				mmap_read_unlock(mm);
 				*result = hpage_collapse_scan_file(mm,
-								   khugepaged_scan.address,
+								   scan->address,
 								   file, pgoff, cc);
 				mmap_locked = false;
 				fput(file);
 			} else {
 				*result = hpage_collapse_scan_pmd(mm, vma,
-								  khugepaged_scan.address,
+								  scan->address,
 								  &mmap_locked,
 								  cc);
 			}
@@ -2536,12 +2644,12 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 				pmd_t *pmd;
 
 				*result = find_pmd_or_thp_or_none(mm,
-								  khugepaged_scan.address,
+								  scan->address,
 								  &pmd);
 				if (*result != SCAN_SUCCEED)
 					break;
 				if (!khugepaged_add_pte_mapped_thp(mm,
-								   khugepaged_scan.address))
+								   scan->address))
 					break;
 			} fallthrough;
 			case SCAN_SUCCEED:
@@ -2552,7 +2660,7 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 			}
 
 			/* move to next address */
-			khugepaged_scan.address += HPAGE_PMD_SIZE;
+			scan->address += HPAGE_PMD_SIZE;
 			progress += HPAGE_PMD_NR;
 			if (!mmap_locked)
 				/*
@@ -2572,7 +2680,7 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 breakouterloop_mmap_lock:
 
 	spin_lock(&khugepaged_mm_lock);
-	VM_BUG_ON(khugepaged_scan.mm_slot != mm_slot);
+	VM_BUG_ON(scan->mm_slot != mm_slot);
 	/*
 	 * Release the current mm_slot if this mm is about to die, or
 	 * if we scanned all vmas of this mm.
@@ -2583,17 +2691,18 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 		 * khugepaged runs here, khugepaged_exit will find
 		 * mm_slot not pointing to the exiting mm.
 		 */
-		if (slot->mm_node.next != &khugepaged_scan.mm_head) {
+		if (slot->mm_node.next != &scan->mm_head) {
 			slot = list_entry(slot->mm_node.next,
 					  struct mm_slot, mm_node);
-			khugepaged_scan.mm_slot =
+			scan->mm_slot =
 				mm_slot_entry(slot, struct khugepaged_mm_slot, slot);
-			khugepaged_scan.address = 0;
+			scan->address = 0;
 		} else {
-			khugepaged_scan.mm_slot = NULL;
-			khugepaged_full_scans++;
+			scan->mm_slot = NULL;
+			(*scan->full_scans)++;
 		}
 
+		khugepaged_requeue_mm_slot(mm_slot);
 		collect_mm_slot(mm_slot);
 	}
 
@@ -2602,58 +2711,81 @@ static unsigned int khugepaged_scan_mm_slot(unsigned int pages, int *result,
 
 static int khugepaged_has_work(void)
 {
-	return !list_empty(&khugepaged_scan.mm_head) &&
-		hugepage_flags_enabled();
+	return khugepaged_has_mm() && hugepage_flags_enabled();
 }
 
 static int khugepaged_wait_event(void)
 {
-	return !list_empty(&khugepaged_scan.mm_head) ||
-		kthread_should_stop();
+	return khugepaged_has_mm() || kthread_should_stop();
 }
 
-static void khugepaged_do_scan(struct collapse_control *cc)
+/*
+ * Scan up to @pages worth of the mms queued on @scan.  Returns false if
+ * khugepaged should give up on this pass entirely.
+ */
+static bool khugepaged_do_scan_list(struct khugepaged_scan *scan,
+				    unsigned int pages, bool *wait,
+				    struct collapse_control *cc)
 {
 	unsigned int progress = 0, pass_through_head = 0;
-	unsigned int pages = READ_ONCE(khugepaged_pages_to_scan);
-	bool wait = true;
 	int result = SCAN_SUCCEED;
 
-	lru_add_drain_all();
-
 	while (true) {
 		cond_resched();
 
 		if (unlikely(kthread_should_stop() || try_to_freeze()))
-			break;
+			return false;
 
 		spin_lock(&khugepaged_mm_lock);
-		if (!khugepaged_scan.mm_slot)
+		if (!scan->mm_slot)
 			pass_through_head++;
-		if (khugepaged_has_work() &&
+		if (!list_empty(&scan->mm_head) &&
+		    hugepage_flags_enabled() &&
 		    pass_through_head < 2)
-			progress += khugepaged_scan_mm_slot(pages - progress,
+			progress += khugepaged_scan_mm_slot(scan,
+							    pages - progress,
 							    &result, cc);
 		else
 			progress = pages;
 		spin_unlock(&khugepaged_mm_lock);
 
 		if (progress >= pages)
-			break;
+			return true;
 
 		if (result == SCAN_ALLOC_HUGE_PAGE_FAIL) {
 			/*
 			 * If fail to allocate the first time, try to sleep for
 			 * a while.  When hit again, cancel the scan.
 			 */
-			if (!wait)
-				break;
-			wait = false;
+			if (!*wait)
+				return false;
+			*wait = false;
 			khugepaged_alloc_sleep();
 		}
 	}
 }
 
+static void khugepaged_do_scan(struct collapse_control *cc)
+{
+	bool wait = true;
+
+	lru_add_drain_all();
+
+	/*
+	 * High priority mms get their own budget and are serviced before
+	 * the round-robin walk over everybody else, so that they do not
+	 * wait behind a long list of batch jobs for their collapses.
+	 */
+	if (!khugepaged_do_scan_list(&khugepaged_prio_scan,
+				     READ_ONCE(khugepaged_prio_pages_to_scan),
+				     &wait, cc))
+		return;
+
+	khugepaged_do_scan_list(&khugepaged_scan,
+				READ_ONCE(khugepaged_pages_to_scan),
+				&wait, cc);
+}
+
 static bool khugepaged_should_wakeup(void)
 {
 	return kthread_should_stop() ||
@@ -2695,6 +2827,10 @@ static int khugepaged(void *none)
 	spin_lock(&khugepaged_mm_lock);
 	mm_slot = khugepaged_scan.mm_slot;
 	khugepaged_scan.mm_slot = NULL;
+	if (mm_slot)
+		collect_mm_slot(mm_slot);
+	mm_slot = khugepaged_prio_scan.mm_slot;
+	khugepaged_prio_scan.mm_slot = NULL;
 	if (mm_slot)
 		collect_mm_slot(mm_slot);
 	spin_unlock(&khugepaged_mm_lock);
@@ -2768,7 +2904,7 @@ int start_stop_khugepaged(void)
 			goto fail;
 		}
 
-		if (!list_empty(&khugepaged_scan.mm_head))
+		if (khugepaged_has_mm())
 			wake_up_interruptible(&khugepaged_wait);
 	} else if (khugepaged_thread) {
 		kthread_stop(khugepaged_thread);
@@ -205,6 +205,8 @@ struct ksm_rmap_item {
 	struct mm_struct *mm;
 	unsigned long address;		/* + low bits used for flags below */
 	unsigned int oldchecksum;	/* when unstable */
+	u8 age;				/* scans without a merge, saturating */
+	u8 remaining_skips;		/* smart scan: scans left to skip */
 	union {
 		struct rb_node node;	/* when node of unstable tree */
 		struct {		/* when listed from stable tree */
@@ -272,6 +274,21 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Number of workers ksmd spreads page checksumming over, 1 = ksmd only */
+static unsigned int ksm_scan_workers = 1;
+
+/* Skip pages that keep failing to merge, with a growing backoff */
+static bool ksm_smart_scan = true;
+
+/* The number of pages scanned by ksmd */
+static unsigned long ksm_pages_scanned;
+
+/* The number of pages skipped by smart scan */
+static unsigned long ksm_pages_skipped;
+
+/* The number of page checksums computed by the scan workers */
+static unsigned long ksm_pages_checksummed_parallel;
+
 /* Checksum of an empty (zeroed) page */
 static unsigned int zero_checksum __read_mostly;
 
@@ -2079,6 +2096,7 @@ static void stable_tree_append(struct ksm_rmap_item *rmap_item,
 
 	rmap_item->head = stable_node;
 	rmap_item->address |= STABLE_FLAG;
+	rmap_item->age = 0;
 	hlist_add_head(&rmap_item->hlist, &stable_node->hlist);
 
 	if (rmap_item->hlist.next)
@@ -2097,8 +2115,10 @@ static void stable_tree_append(struct ksm_rmap_item *rmap_item,
  *
  * @page: the page that we are searching identical page to.
  * @rmap_item: the reverse mapping into the virtual address of this page
+ * @precomputed: checksum of @page if a scan worker calculated it, or NULL
  */
-static void cmp_and_merge_page(struct page *page, struct ksm_rmap_item *rmap_item)
+static void cmp_and_merge_page(struct page *page, struct ksm_rmap_item *rmap_item,
+			       const u32 *precomputed)
 {
 	struct mm_struct *mm = rmap_item->mm;
 	struct ksm_rmap_item *tree_rmap_item;
@@ -2163,7 +2183,7 @@ static void cmp_and_merge_page(struct page *page, struct ksm_rmap_item *rmap_ite
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
 	 */
-	checksum = calc_checksum(page);
+	checksum = precomputed ? *precomputed : calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
 		return;
@@ -2291,7 +2311,14 @@ static struct ksm_rmap_item *get_next_rmap_item(struct ksm_mm_slot *mm_slot,
 	return rmap_item;
 }
 
-static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
+/*
+ * With @defer_mm_end set, return NULL instead of finishing the current mm
+ * once its vmas are exhausted: finishing frees its trailing rmap_items,
+ * which the caller may still hold in a batch.  Calling again with
+ * @defer_mm_end clear resumes at the same point.
+ */
+static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page,
+						     bool defer_mm_end)
 {
 	struct mm_struct *mm;
 	struct ksm_mm_slot *mm_slot;
@@ -2366,7 +2393,7 @@ static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 
 	mmap_read_lock(mm);
 	if (ksm_test_exit(mm))
-		goto no_vmas;
+		goto mm_end;
 
 	for_each_vma(vmi, vma) {
 		if (!(vma->vm_flags & VM_MERGEABLE))
@@ -2408,8 +2435,13 @@ static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 		}
 	}
 
+mm_end:
+	if (defer_mm_end) {
+		mmap_read_unlock(mm);
+		return NULL;
+	}
+
 	if (ksm_test_exit(mm)) {
-no_vmas:
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &mm_slot->rmap_list;
 	}
@@ -2464,6 +2496,173 @@ static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 	return NULL;
 }
 
+static unsigned int skip_age(u8 age)
+{
+	if (age <= 3)
+		return 1;
+	if (age <= 5)
+		return 2;
+	if (age <= 8)
+		return 4;
+
+	return 8;
+}
+
+/*
+ * Smart scan: a page that went through several scans without being merged
+ * is likely to stay unmergeable, so skip it for a number of scans that
+ * grows with its age.  Pages already merged are never skipped.
+ */
+static bool should_skip_rmap_item(struct page *page,
+				  struct ksm_rmap_item *rmap_item)
+{
+	u8 age;
+
+	if (!ksm_smart_scan)
+		return false;
+
+	if (PageKsm(page))
+		return false;
+
+	age = rmap_item->age;
+	if (age != U8_MAX)
+		rmap_item->age++;
+
+	/* Young pages get a chance to go through every merge phase first */
+	if (age < 3)
+		return false;
+
+	if (!rmap_item->remaining_skips) {
+		rmap_item->remaining_skips = skip_age(age);
+		return false;
+	}
+
+	ksm_pages_skipped++;
+	rmap_item->remaining_skips--;
+	remove_rmap_item_from_tree(rmap_item);
+	return true;
+}
+
+/*
+ * ksmd gathers up to KSM_SCAN_BATCH pages of one mm before processing them.
+ * With more than one scan worker, the checksums of a batch are calculated
+ * by work items queued on the node each page lives on, while the tree
+ * searches and merging stay serialized in ksmd under ksm_thread_mutex.
+ */
+#define KSM_SCAN_BATCH		32
+#define KSM_SCAN_WORKERS_MAX	64
+
+struct ksm_scan_item {
+	struct ksm_rmap_item *rmap_item;
+	struct page *page;
+	u32 checksum;
+	bool checksummed;
+	bool skip;
+	u8 worker;
+};
+
+struct ksm_checksum_work {
+	struct work_struct work;
+	struct ksm_scan_item *items;
+	unsigned int nr_items;
+	unsigned int worker;
+	unsigned long nr_done;
+};
+
+static struct workqueue_struct *ksm_scan_wq;
+static struct ksm_scan_item ksm_scan_batch[KSM_SCAN_BATCH];
+static struct ksm_checksum_work ksm_checksum_works[KSM_SCAN_WORKERS_MAX];
+
+static void ksm_checksum_fn(struct work_struct *work)
+{
+	struct ksm_checksum_work *cw =
+		container_of(work, struct ksm_checksum_work, work);
+	unsigned int i;
+
+	for (i = 0; i < cw->nr_items; i++) {
+		struct ksm_scan_item *item = &cw->items[i];
+
+		if (item->worker != cw->worker)
+			continue;
+
+		item->checksum = calc_checksum(item->page);
+		item->checksummed = true;
+		cw->nr_done++;
+	}
+}
+
+/*
+ * Workers are shared out evenly between the online nodes, and the pages
+ * of a node round-robin between that node's workers.
+ */
+static void ksm_checksum_batch(unsigned int nr)
+{
+	unsigned int nr_workers = READ_ONCE(ksm_scan_workers);
+	DECLARE_BITMAP(busy, KSM_SCAN_WORKERS_MAX);
+	int nids[KSM_SCAN_WORKERS_MAX];
+	unsigned int per_node, i, w;
+
+	if (nr_workers <= 1 || !ksm_scan_wq)
+		return;
+
+	bitmap_zero(busy, KSM_SCAN_WORKERS_MAX);
+	per_node = max(nr_workers / num_online_nodes(), 1U);
+
+	for (i = 0; i < nr; i++) {
+		struct ksm_scan_item *item = &ksm_scan_batch[i];
+		int nid = page_to_nid(item->page);
+
+		/* Skipped and merged pages never need their checksum */
+		if (item->skip || PageKsm(item->page)) {
+			item->worker = U8_MAX;
+			continue;
+		}
+
+		w = (nid * per_node + i % per_node) % nr_workers;
+		item->worker = w;
+		if (!__test_and_set_bit(w, busy))
+			nids[w] = nid;
+	}
+
+	for_each_set_bit(w, busy, KSM_SCAN_WORKERS_MAX) {
+		struct ksm_checksum_work *cw = &ksm_checksum_works[w];
+
+		INIT_WORK(&cw->work, ksm_checksum_fn);
+		cw->items = ksm_scan_batch;
+		cw->nr_items = nr;
+		cw->worker = w;
+		cw->nr_done = 0;
+		queue_work_node(nids[w], ksm_scan_wq, &cw->work);
+	}
+
+	for_each_set_bit(w, busy, KSM_SCAN_WORKERS_MAX) {
+		flush_work(&ksm_checksum_works[w].work);
+		ksm_pages_checksummed_parallel += ksm_checksum_works[w].nr_done;
+	}
+}
+
+static void ksm_process_batch(unsigned int nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++)
+		ksm_scan_batch[i].skip =
+			should_skip_rmap_item(ksm_scan_batch[i].page,
+					      ksm_scan_batch[i].rmap_item);
+
+	ksm_checksum_batch(nr);
+
+	for (i = 0; i < nr; i++) {
+		struct ksm_scan_item *item = &ksm_scan_batch[i];
+
+		if (!item->skip)
+			cmp_and_merge_page(item->page, item->rmap_item,
+					   item->checksummed ?
+					   &item->checksum : NULL);
+		put_page(item->page);
+	}
+}
+
 /**
  * ksm_do_scan  - the ksm scanner main worker function.
  * @scan_npages:  number of pages we want to scan before we return.
@@ -2471,16 +2670,35 @@ static struct ksm_rmap_item *scan_get_next_rmap_item(struct page **page)
 static void ksm_do_scan(unsigned int scan_npages)
 {
 	struct ksm_rmap_item *rmap_item;
+	unsigned int nr = 0;
 	struct page *page;
 
-	while (scan_npages-- && likely(!freezing(current))) {
+	while (scan_npages && likely(!freezing(current))) {
 		cond_resched();
-		rmap_item = scan_get_next_rmap_item(&page);
-		if (!rmap_item)
-			return;
-		cmp_and_merge_page(page, rmap_item);
-		put_page(page);
+		rmap_item = scan_get_next_rmap_item(&page, nr);
+		if (!rmap_item) {
+			if (!nr)
+				return;
+			/* End of this mm: process the batch, then move on */
+			ksm_process_batch(nr);
+			nr = 0;
+			continue;
+		}
+
+		scan_npages--;
+		ksm_pages_scanned++;
+		ksm_scan_batch[nr++] = (struct ksm_scan_item) {
+			.rmap_item = rmap_item,
+			.page = page,
+		};
+		if (nr == KSM_SCAN_BATCH) {
+			ksm_process_batch(nr);
+			nr = 0;
+		}
 	}
+
+	if (nr)
+		ksm_process_batch(nr);
 }
 
 static int ksmd_should_run(void)
@@ -3418,6 +3636,72 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t smart_scan_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", ksm_smart_scan);
+}
+
+static ssize_t smart_scan_store(struct kobject *kobj,
+				struct kobj_attribute *attr,
+				const char *buf, size_t count)
+{
+	int err;
+	bool value;
+
+	err = kstrtobool(buf, &value);
+	if (err)
+		return -EINVAL;
+
+	ksm_smart_scan = value;
+	return count;
+}
+KSM_ATTR(smart_scan);
+
+static ssize_t scan_workers_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", ksm_scan_workers);
+}
+
+static ssize_t scan_workers_store(struct kobject *kobj,
+				  struct kobj_attribute *attr,
+				  const char *buf, size_t count)
+{
+	unsigned int nr_workers;
+	int err;
+
+	err = kstrtouint(buf, 10, &nr_workers);
+	if (err || !nr_workers || nr_workers > KSM_SCAN_WORKERS_MAX)
+		return -EINVAL;
+
+	WRITE_ONCE(ksm_scan_workers, nr_workers);
+	return count;
+}
+KSM_ATTR(scan_workers);
+
+static ssize_t pages_scanned_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", ksm_pages_scanned);
+}
+KSM_ATTR_RO(pages_scanned);
+
+static ssize_t pages_skipped_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", ksm_pages_skipped);
+}
+KSM_ATTR_RO(pages_skipped);
+
+static ssize_t pages_checksummed_parallel_show(struct kobject *kobj,
+					       struct kobj_attribute *attr,
+					       char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", ksm_pages_checksummed_parallel);
+}
+KSM_ATTR_RO(pages_checksummed_parallel);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -3436,6 +3720,11 @@ static struct attribute *ksm_attrs[] = {
 	&stable_node_chains_prune_millisecs_attr.attr,
 	&use_zero_pages_attr.attr,
 	&general_profit_attr.attr,
+	&smart_scan_attr.attr,
+	&scan_workers_attr.attr,
+	&pages_scanned_attr.attr,
+	&pages_skipped_attr.attr,
+	&pages_checksummed_parallel_attr.attr,
 	NULL,
 };
 
@@ -3459,6 +3748,9 @@ static int __init ksm_init(void)
 	if (err)
 		goto out;
 
+	/* Without the workqueue, ksmd calculates all checksums itself */
+	ksm_scan_wq = alloc_workqueue("ksm_scan_wq", WQ_UNBOUND, 0);
+
 	ksm_thread = kthread_run(ksm_scan_thread, NULL, "ksmd");
 	if (IS_ERR(ksm_thread)) {
 		pr_err("ksm: creating kthread failed\n");
@@ -327,6 +327,36 @@ int next_demotion_node(int node)
 	return target;
 }
 
+/**
+ * next_promotion_node() - Get the next node in the promotion path
+ * @node: The starting node to lookup the next node
+ *
+ * Return: the node closest to @node among the nodes that would demote to
+ * @node, i.e. the reverse of next_demotion_node(); NUMA_NO_NODE if @node
+ * is in the top tier or nobody demotes to it.  Like next_demotion_node()
+ * this is only a hint and does not keep the returned node online.
+ */
+int next_promotion_node(int node)
+{
+	int n, target = NUMA_NO_NODE, best = INT_MAX;
+
+	if (!node_demotion)
+		return NUMA_NO_NODE;
+
+	rcu_read_lock();
+	for_each_node_state(n, N_MEMORY) {
+		if (!node_isset(node, node_demotion[n].preferred))
+			continue;
+		if (node_distance(node, n) < best) {
+			best = node_distance(node, n);
+			target = n;
+		}
+	}
+	rcu_read_unlock();
+
+	return target;
+}
+
 static void disable_all_demotion_targets(void)
 {
 	struct memory_tier *memtier;
@@ -1228,7 +1228,10 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 	/* Ensure requested pindex is drained first. */
 	pindex = pindex - 1;
 
-	spin_lock_irqsave(&zone->lock, flags);
+	if (!spin_trylock_irqsave(&zone->lock, flags)) {
+		pcp->nr_contended++;
+		spin_lock_irqsave(&zone->lock, flags);
+	}
 	isolated_pageblocks = has_isolate_pageblock(zone);
 
 	while (count > 0) {
@@ -2154,12 +2157,16 @@ __rmqueue(struct zone *zone, unsigned int order, int migratetype,
  */
 static int rmqueue_bulk(struct zone *zone, unsigned int order,
 			unsigned long count, struct list_head *list,
-			int migratetype, unsigned int alloc_flags)
+			int migratetype, unsigned int alloc_flags,
+			struct per_cpu_pages *pcp)
 {
 	unsigned long flags;
 	int i;
 
-	spin_lock_irqsave(&zone->lock, flags);
+	if (!spin_trylock_irqsave(&zone->lock, flags)) {
+		pcp->nr_contended++;
+		spin_lock_irqsave(&zone->lock, flags);
+	}
 	for (i = 0; i < count; ++i) {
 		struct page *page = __rmqueue(zone, order, migratetype,
 								alloc_flags);
@@ -2188,6 +2195,52 @@ static int rmqueue_bulk(struct zone *zone, unsigned int order,
 	return i;
 }
 
+/*
+ * With vm.percpu_pagelist_adaptive set, pcp->high and pcp->batch are sized
+ * once per vmstat interval from the traffic the pcp lists saw: high is
+ * made large enough to absorb 1/PCP_ADAPTIVE_HIGH_DIV of the interval's
+ * allocations or frees, doubled while zone->lock was found contended, and
+ * batch follows at 1/PCP_ADAPTIVE_BATCH_DIV of high.  Both stay within the
+ * zone's limits: high within [high_min, high_max], batch within
+ * [zone->pageset_batch, zone->pageset_batch << CONFIG_PCP_BATCH_SCALE_MAX].
+ * High grows to the target at once but, as in the non-adaptive decay, only
+ * shrinks by a bounded step per interval so that a quiet interval does not
+ * drain the whole list in one go.
+ */
+#define PCP_ADAPTIVE_HIGH_DIV	4
+#define PCP_ADAPTIVE_BATCH_DIV	8
+
+static int percpu_pagelist_adaptive;
+
+/* Return whether pcp->high is still above the target and decaying. */
+static bool pcp_adaptive_tune(struct zone *zone, struct per_cpu_pages *pcp)
+{
+	int high_min = READ_ONCE(pcp->high_min);
+	int high_max = READ_ONCE(pcp->high_max);
+	int base_batch = zone->pageset_batch;
+	int target, batch;
+
+	/* PCP disabled, boot pageset or high tuned manually */
+	if (high_min == high_max || base_batch <= 1)
+		return false;
+
+	target = max(pcp->alloc_rate, pcp->free_rate) / PCP_ADAPTIVE_HIGH_DIV;
+	if (pcp->contended_rate)
+		target <<= 1;
+	target = clamp(target, high_min, high_max);
+	if (target < pcp->high)
+		pcp->high = max3(pcp->count - (pcp->batch << CONFIG_PCP_BATCH_SCALE_MAX),
+				 pcp->high - (pcp->high >> 3), target);
+	else
+		pcp->high = target;
+
+	batch = clamp(pcp->high / PCP_ADAPTIVE_BATCH_DIV, base_batch,
+		      base_batch << CONFIG_PCP_BATCH_SCALE_MAX);
+	WRITE_ONCE(pcp->batch, batch);
+
+	return pcp->high > target;
+}
+
 /*
  * Called from the vmstat counter updater to decay the PCP high.
  * Return whether there are addition works to do.
@@ -2197,14 +2250,28 @@ int decay_pcp_high(struct zone *zone, struct per_cpu_pages *pcp)
 	int high_min, to_drain, batch;
 	int todo = 0;
 
+	spin_lock(&pcp->lock);
+	pcp->alloc_rate = pcp->nr_alloc;
+	pcp->free_rate = pcp->nr_free;
+	pcp->contended_rate = pcp->nr_contended;
+	pcp->nr_alloc = pcp->nr_free = pcp->nr_contended = 0;
+	if (READ_ONCE(percpu_pagelist_adaptive)) {
+		if (pcp_adaptive_tune(zone, pcp))
+			todo++;
+		trace_mm_pcp_tune(zone, pcp);
+	}
+	spin_unlock(&pcp->lock);
+
 	high_min = READ_ONCE(pcp->high_min);
 	batch = READ_ONCE(pcp->batch);
 	/*
 	 * Decrease pcp->high periodically to try to free possible
 	 * idle PCP pages.  And, avoid to free too many pages to
 	 * control latency.  This caps pcp->high decrement too.
+	 * The adaptive mode decays pcp->high the same way, towards the
+	 * target sized from the traffic above.
 	 */
-	if (pcp->high > high_min) {
+	if (!READ_ONCE(percpu_pagelist_adaptive) && pcp->high > high_min) {
 		pcp->high = max3(pcp->count - (batch << CONFIG_PCP_BATCH_SCALE_MAX),
 				 pcp->high - (pcp->high >> 3), high_min);
 		if (pcp->high > high_min)
@@ -2474,6 +2541,7 @@ static void free_unref_page_commit(struct zone *zone, struct per_cpu_pages *pcp,
 	pindex = order_to_pindex(migratetype, order);
 	list_add(&page->pcp_list, &pcp->lists[pindex]);
 	pcp->count += 1 << order;
+	pcp->nr_free += 1 << order;
 
 	batch = READ_ONCE(pcp->batch);
 	/*
@@ -2851,7 +2919,7 @@ struct page *__rmqueue_pcplist(struct zone *zone, unsigned int order,
 
 			alloced = rmqueue_bulk(zone, order,
 					batch, list,
-					migratetype, alloc_flags);
+					migratetype, alloc_flags, pcp);
 
 			pcp->count += alloced << order;
 			if (unlikely(list_empty(list)))
@@ -2863,6 +2931,8 @@ struct page *__rmqueue_pcplist(struct zone *zone, unsigned int order,
 		pcp->count -= 1 << order;
 	} while (check_new_pages(page, order));
 
+	pcp->nr_alloc += 1 << order;
+
 	return page;
 }
 
@@ -6172,6 +6242,30 @@ static int percpu_pagelist_high_fraction_sysctl_handler(struct ctl_table *table,
 	return ret;
 }
 
+/*
+ * percpu_pagelist_adaptive - size pcp->high and pcp->batch from the observed
+ * per-cpu traffic, see pcp_adaptive_tune().  Turning it off restores the
+ * zone's default batch.
+ */
+static int percpu_pagelist_adaptive_sysctl_handler(struct ctl_table *table,
+		int write, void *buffer, size_t *length, loff_t *ppos)
+{
+	struct zone *zone;
+	int ret;
+
+	mutex_lock(&pcp_batch_high_lock);
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (write && !ret && !percpu_pagelist_adaptive) {
+		for_each_populated_zone(zone)
+			__zone_set_pageset_high_and_batch(zone,
+					zone->pageset_high_min,
+					zone->pageset_high_max,
+					zone->pageset_batch);
+	}
+	mutex_unlock(&pcp_batch_high_lock);
+	return ret;
+}
+
 static struct ctl_table page_alloc_sysctl_table[] = {
 	{
 		.procname	= "min_free_kbytes",
@@ -6206,6 +6300,15 @@ static struct ctl_table page_alloc_sysctl_table[] = {
 		.proc_handler	= percpu_pagelist_high_fraction_sysctl_handler,
 		.extra1		= SYSCTL_ZERO,
 	},
+	{
+		.procname	= "percpu_pagelist_adaptive",
+		.data		= &percpu_pagelist_adaptive,
+		.maxlen		= sizeof(percpu_pagelist_adaptive),
+		.mode		= 0644,
+		.proc_handler	= percpu_pagelist_adaptive_sysctl_handler,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
 	{
 		.procname	= "lowmem_reserve_ratio",
 		.data		= &sysctl_lowmem_reserve_ratio,
@@ -2389,6 +2389,35 @@ static void *get_partial(struct kmem_cache *s, int node, struct partial_context
 	return get_any_partial(s, pc);
 }
 
+#ifndef CONFIG_SLUB_TINY
+static void *alloc_from_sheaf(struct kmem_cache *s, gfp_t gfpflags);
+static bool free_to_sheaf(struct kmem_cache *s, struct slab *slab,
+			  void **head, void **tail, int *cnt);
+static void flush_sheaf(struct kmem_cache *s);
+static void __flush_cpu_sheaf(struct kmem_cache *s, int cpu);
+
+static inline bool slub_has_sheaves(struct kmem_cache *s)
+{
+	return s->cpu_sheaves;
+}
+#else
+static inline void *alloc_from_sheaf(struct kmem_cache *s, gfp_t gfpflags)
+{
+	return NULL;
+}
+
+static inline bool free_to_sheaf(struct kmem_cache *s, struct slab *slab,
+				 void **head, void **tail, int *cnt)
+{
+	return false;
+}
+
+static inline bool slub_has_sheaves(struct kmem_cache *s)
+{
+	return false;
+}
+#endif /* CONFIG_SLUB_TINY */
+
 #ifndef CONFIG_SLUB_TINY
 
 #ifdef CONFIG_PREEMPTION
@@ -2785,6 +2814,9 @@ static void flush_cpu_slab(struct work_struct *w)
 	s = sfw->s;
 	c = this_cpu_ptr(s->cpu_slab);
 
+	if (slub_has_sheaves(s))
+		flush_sheaf(s);
+
 	if (c->slab)
 		flush_slab(s, c);
 
@@ -2795,6 +2827,9 @@ static bool has_cpu_slab(int cpu, struct kmem_cache *s)
 {
 	struct kmem_cache_cpu *c = per_cpu_ptr(s->cpu_slab, cpu);
 
+	if (slub_has_sheaves(s) && per_cpu_ptr(s->cpu_sheaves, cpu)->size)
+		return true;
+
 	return c->slab || slub_percpu_partial(c);
 }
 
@@ -2847,8 +2882,11 @@ static int slub_cpu_dead(unsigned int cpu)
 	struct kmem_cache *s;
 
 	mutex_lock(&slab_mutex);
-	list_for_each_entry(s, &slab_caches, list)
+	list_for_each_entry(s, &slab_caches, list) {
+		if (slub_has_sheaves(s))
+			__flush_cpu_sheaf(s, cpu);
 		__flush_cpu_slab(s, cpu);
+	}
 	mutex_unlock(&slab_mutex);
 	return 0;
 }
@@ -3438,7 +3476,11 @@ static __fastpath_inline void *slab_alloc_node(struct kmem_cache *s, struct list
 	if (unlikely(object))
 		goto out;
 
-	object = __slab_alloc_node(s, gfpflags, node, addr, orig_size);
+	object = NULL;
+	if (slub_has_sheaves(s) && node == NUMA_NO_NODE)
+		object = alloc_from_sheaf(s, gfpflags);
+	if (!object)
+		object = __slab_alloc_node(s, gfpflags, node, addr, orig_size);
 
 	maybe_wipe_obj_freeptr(s, object);
 	init = slab_want_init_on_alloc(gfpflags, s);
@@ -3783,8 +3825,13 @@ static __fastpath_inline void slab_free(struct kmem_cache *s, struct slab *slab,
 	 * With KASAN enabled slab_free_freelist_hook modifies the freelist
 	 * to remove objects, whose reuse must be delayed.
 	 */
-	if (slab_free_freelist_hook(s, &head, &tail, &cnt))
-		do_slab_free(s, slab, head, tail, cnt, addr);
+	if (!slab_free_freelist_hook(s, &head, &tail, &cnt))
+		return;
+
+	if (slub_has_sheaves(s) && free_to_sheaf(s, slab, &head, &tail, &cnt))
+		return;
+
+	do_slab_free(s, slab, head, tail, cnt, addr);
 }
 
 #ifdef CONFIG_KASAN_GENERIC
@@ -4036,6 +4083,178 @@ int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t size,
 }
 EXPORT_SYMBOL(kmem_cache_alloc_bulk);
 
+#ifndef CONFIG_SLUB_TINY
+/*
+ * Per cpu sheaves for SLAB_SHEAVES caches.
+ *
+ * Objects enter a sheaf from slab_free() after the free hooks have run, and
+ * leave it from slab_alloc_node() before the alloc hooks run, so memcg
+ * charging, KASAN and init_on_alloc/free see every object as usual.  An
+ * empty sheaf is refilled with one bulk allocation and a full one is
+ * halved by returning its oldest objects to their slabs in one go, so the
+ * slab freelists and list_lock are touched once per SLUB_SHEAF_BATCH
+ * objects instead of once per object.  Bulk frees, which is how kfree_rcu()
+ * releases its batches, go into the sheaf under a single lock round trip.
+ */
+
+/* Return objects that have already been through the free hooks. */
+static void sheaf_free_objects(struct kmem_cache *s, void **p,
+			       unsigned int size)
+{
+	while (size) {
+		struct detached_freelist df;
+
+		size = build_detached_freelist(s, size, p, &df);
+		if (!df.slab)
+			continue;
+
+		do_slab_free(df.s, df.slab, df.freelist, df.tail, df.cnt,
+			     _RET_IP_);
+	}
+}
+
+static void *alloc_from_sheaf(struct kmem_cache *s, gfp_t gfpflags)
+{
+	void *objects[SLUB_SHEAF_BATCH];
+	struct slub_sheaf *sheaf;
+	unsigned long flags;
+	unsigned int filled, nr;
+	void *object;
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	sheaf = this_cpu_ptr(s->cpu_sheaves);
+	if (likely(sheaf->size)) {
+		object = sheaf->objects[--sheaf->size];
+		local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+		stat(s, SHEAF_ALLOC);
+		return object;
+	}
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+	stat(s, SHEAF_ALLOC_MISS);
+
+	/* __kmem_cache_alloc_bulk() must be called with interrupts enabled */
+	if (irqs_disabled())
+		return NULL;
+
+	filled = __kmem_cache_alloc_bulk(s, gfpflags & ~__GFP_ZERO,
+					 SLUB_SHEAF_BATCH, objects, NULL);
+	if (!filled)
+		return NULL;
+	stat(s, SHEAF_REFILL);
+	object = objects[--filled];
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	sheaf = this_cpu_ptr(s->cpu_sheaves);
+	nr = min(filled, SLUB_SHEAF_CAPACITY - sheaf->size);
+	memcpy(&sheaf->objects[sheaf->size], objects, nr * sizeof(void *));
+	sheaf->size += nr;
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+	/* Raced with frees or got migrated to a fuller sheaf */
+	if (unlikely(nr < filled))
+		sheaf_free_objects(s, objects + nr, filled - nr);
+
+	return object;
+}
+
+/*
+ * Move the objects of the freelist @head..@tail into this cpu's sheaf.
+ * Returns true if all @cnt objects were consumed; otherwise @head, @tail
+ * and @cnt describe what is left for the caller to free to the slab.
+ */
+static bool free_to_sheaf(struct kmem_cache *s, struct slab *slab,
+			  void **head, void **tail, int *cnt)
+{
+	void *flush[SLUB_SHEAF_BATCH];
+	struct slub_sheaf *sheaf;
+	unsigned int nr_flush = 0;
+	unsigned long flags;
+	int nr = *cnt;
+
+	/* Keep remote objects and kfence objects off the sheaf */
+	if (unlikely(slab_nid(slab) != numa_mem_id() ||
+		     is_kfence_address(*head)))
+		return false;
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	sheaf = this_cpu_ptr(s->cpu_sheaves);
+	if (sheaf->size + *cnt > SLUB_SHEAF_CAPACITY &&
+	    sheaf->size >= SLUB_SHEAF_BATCH) {
+		nr_flush = SLUB_SHEAF_BATCH;
+		memcpy(flush, sheaf->objects, nr_flush * sizeof(void *));
+		sheaf->size -= nr_flush;
+		memmove(sheaf->objects, &sheaf->objects[nr_flush],
+			sheaf->size * sizeof(void *));
+	}
+	while (*cnt && sheaf->size < SLUB_SHEAF_CAPACITY) {
+		void *object = *head;
+
+		if (--(*cnt))
+			*head = get_freepointer(s, object);
+		sheaf->objects[sheaf->size++] = object;
+	}
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+	if (*cnt == 1)
+		*tail = NULL;
+	stat(s, nr > 1 ? SHEAF_FREE_BULK : SHEAF_FREE);
+
+	if (nr_flush) {
+		sheaf_free_objects(s, flush, nr_flush);
+		stat(s, SHEAF_FLUSH);
+	}
+
+	return !*cnt;
+}
+
+/* Flush the sheaf of the current cpu; called with migration disabled. */
+static void flush_sheaf(struct kmem_cache *s)
+{
+	void *objects[SLUB_SHEAF_CAPACITY];
+	struct slub_sheaf *sheaf;
+	unsigned long flags;
+	unsigned int size;
+
+	local_lock_irqsave(&s->cpu_sheaves->lock, flags);
+	sheaf = this_cpu_ptr(s->cpu_sheaves);
+	size = sheaf->size;
+	memcpy(objects, sheaf->objects, size * sizeof(void *));
+	sheaf->size = 0;
+	local_unlock_irqrestore(&s->cpu_sheaves->lock, flags);
+
+	if (size) {
+		sheaf_free_objects(s, objects, size);
+		stat(s, SHEAF_FLUSH);
+	}
+}
+
+/* Flush the sheaf of an offline cpu. */
+static void __flush_cpu_sheaf(struct kmem_cache *s, int cpu)
+{
+	struct slub_sheaf *sheaf = per_cpu_ptr(s->cpu_sheaves, cpu);
+
+	sheaf_free_objects(s, sheaf->objects, sheaf->size);
+	sheaf->size = 0;
+}
+
+static int alloc_kmem_cache_sheaves(struct kmem_cache *s)
+{
+	int cpu;
+
+	if (!(s->flags & SLAB_SHEAVES) || kmem_cache_debug(s))
+		return 1;
+
+	s->cpu_sheaves = alloc_percpu(struct slub_sheaf);
+	if (!s->cpu_sheaves)
+		return 0;
+
+	for_each_possible_cpu(cpu)
+		local_lock_init(&per_cpu_ptr(s->cpu_sheaves, cpu)->lock);
+
+	return 1;
+}
+#endif /* CONFIG_SLUB_TINY */
+
 /*
  * Object placement in a slab is made very easy because we always start at
  * offset 0. If we tune the size of the object to the alignment then we can
@@ -4278,6 +4497,7 @@ void __kmem_cache_release(struct kmem_cache *s)
 {
 	cache_random_seq_destroy(s);
 #ifndef CONFIG_SLUB_TINY
+	free_percpu(s->cpu_sheaves);
 	free_percpu(s->cpu_slab);
 #endif
 	free_kmem_cache_nodes(s);
@@ -4533,8 +4753,15 @@ static int kmem_cache_open(struct kmem_cache *s, slab_flags_t flags)
 	if (!init_kmem_cache_nodes(s))
 		goto error;
 
-	if (alloc_kmem_cache_cpus(s))
+	if (!alloc_kmem_cache_cpus(s))
+		goto error;
+
+#ifndef CONFIG_SLUB_TINY
+	if (alloc_kmem_cache_sheaves(s))
 		return 0;
+#else
+	return 0;
+#endif
 
 error:
 	__kmem_cache_release(s);
@@ -5910,6 +6137,12 @@ STAT_ATTR(CPU_PARTIAL_ALLOC, cpu_partial_alloc);
 STAT_ATTR(CPU_PARTIAL_FREE, cpu_partial_free);
 STAT_ATTR(CPU_PARTIAL_NODE, cpu_partial_node);
 STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
+STAT_ATTR(SHEAF_ALLOC, sheaf_alloc);
+STAT_ATTR(SHEAF_ALLOC_MISS, sheaf_alloc_miss);
+STAT_ATTR(SHEAF_FREE, sheaf_free);
+STAT_ATTR(SHEAF_FREE_BULK, sheaf_free_bulk);
+STAT_ATTR(SHEAF_REFILL, sheaf_refill);
+STAT_ATTR(SHEAF_FLUSH, sheaf_flush);
 #endif	/* CONFIG_SLUB_STATS */
 
 #ifdef CONFIG_KFENCE
@@ -5997,6 +6230,12 @@ static struct attribute *slab_attrs[] = {
 	&cpu_partial_free_attr.attr,
 	&cpu_partial_node_attr.attr,
 	&cpu_partial_drain_attr.attr,
+	&sheaf_alloc_attr.attr,
+	&sheaf_alloc_miss_attr.attr,
+	&sheaf_free_attr.attr,
+	&sheaf_free_bulk_attr.attr,
+	&sheaf_refill_attr.attr,
+	&sheaf_flush_attr.attr,
 #endif
 #ifdef CONFIG_FAILSLAB
 	&failslab_attr.attr,
@@ -2367,7 +2367,7 @@ static void enable_swap_info(struct swap_info_struct *p, int prio,
 				unsigned char *swap_map,
 				struct swap_cluster_info *cluster_info)
 {
-	zswap_swapon(p->type);
+	zswap_swapon(p->type, p->max);
 
 	spin_lock(&swap_lock);
 	spin_lock(&p->lock);
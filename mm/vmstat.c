@@ -1279,6 +1279,8 @@ const char * const vmstat_text[] = {
 	"pgdemote_kswapd",
 	"pgdemote_direct",
 	"pgdemote_khugepaged",
+	"pgdemote_damon",
+	"pgpromote_damon",
 	"pgscan_kswapd",
 	"pgscan_direct",
 	"pgscan_khugepaged",
@@ -1328,6 +1330,10 @@ const char * const vmstat_text[] = {
 	"compact_daemon_wake",
 	"compact_daemon_migrate_scanned",
 	"compact_daemon_free_scanned",
+	"compact_daemon_worker_run",
+	"compact_daemon_worker_migrate_scanned",
+	"compact_daemon_worker_free_scanned",
+	"compact_daemon_worker_migrated",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -1740,11 +1746,21 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   "\n    cpu: %i"
 			   "\n              count: %i"
 			   "\n              high:  %i"
-			   "\n              batch: %i",
+			   "\n              batch: %i"
+			   "\n              high_min: %i"
+			   "\n              high_max: %i"
+			   "\n              alloc_rate: %i"
+			   "\n              free_rate: %i"
+			   "\n              lock_contended: %i",
 			   i,
 			   pcp->count,
 			   pcp->high,
-			   pcp->batch);
+			   pcp->batch,
+			   pcp->high_min,
+			   pcp->high_max,
+			   pcp->alloc_rate,
+			   pcp->free_rate,
+			   pcp->contended_rate);
 #ifdef CONFIG_SMP
 		pzstats = per_cpu_ptr(zone->per_cpu_zonestats, i);
 		seq_printf(m, "\n  vm stats threshold: %d",
@@ -20,7 +20,7 @@
 #include <linux/spinlock.h>
 #include <linux/types.h>
 #include <linux/atomic.h>
-#include <linux/rbtree.h>
+#include <linux/xarray.h>
 #include <linux/swap.h>
 #include <linux/crypto.h>
 #include <linux/scatterlist.h>
@@ -35,6 +35,7 @@
 #include <linux/pagemap.h>
 #include <linux/workqueue.h>
 #include <linux/list_lru.h>
+#include <linux/timekeeping.h>
 
 #include "swap.h"
 #include "internal.h"
@@ -70,6 +71,12 @@ static u64 zswap_reject_alloc_fail;
 static u64 zswap_reject_kmemcache_fail;
 /* Duplicate store was encountered (rare) */
 static u64 zswap_duplicate_entry;
+/* Batched compression submissions made to the acomp instance */
+static u64 zswap_compress_batches;
+/* Pages compressed through batched submissions */
+static u64 zswap_compress_batch_pages;
+/* Time spent in batched compression, in nanoseconds */
+static u64 zswap_compress_batch_ns;
 
 /* Shrinker work queue */
 static struct workqueue_struct *shrink_wq;
@@ -142,23 +149,36 @@ static bool zswap_exclusive_loads_enabled = IS_ENABLED(
 		CONFIG_ZSWAP_EXCLUSIVE_LOADS_DEFAULT_ON);
 module_param_named(exclusive_loads, zswap_exclusive_loads_enabled, bool, 0644);
 
+/*
+ * Maximum number of pages of a large folio submitted to the compressor in
+ * one go.  Values above ZSWAP_MAX_BATCH_SIZE are clamped; 1 disables
+ * batching.
+ */
+#define ZSWAP_MAX_BATCH_SIZE 8U
+static unsigned int zswap_compress_batch_size = ZSWAP_MAX_BATCH_SIZE;
+module_param_named(compress_batch_size, zswap_compress_batch_size, uint, 0644);
+
 /*********************************
 * data structures
 **********************************/
 
+/*
+ * Requests, waits and destination buffers come in sets of
+ * ZSWAP_MAX_BATCH_SIZE so that several pages can be in flight in the acomp
+ * instance at once; single page operations use the first set.
+ */
 struct crypto_acomp_ctx {
 	struct crypto_acomp *acomp;
-	struct acomp_req *req;
-	struct crypto_wait wait;
-	u8 *dstmem;
+	struct acomp_req *reqs[ZSWAP_MAX_BATCH_SIZE];
+	struct crypto_wait waits[ZSWAP_MAX_BATCH_SIZE];
+	u8 **dstmem;
 	struct mutex *mutex;
 };
 
 /*
- * The lock ordering is zswap_tree.lock -> zswap_pool.lru_lock.
- * The only case where lru_lock is not acquired while holding tree.lock is
- * when a zswap_entry is taken off the lru for writeback, in that case it
- * needs to be verified that it's still valid in the tree.
+ * When a zswap_entry is taken off the lru for writeback, the lru lock is
+ * dropped before the entry is pinned, so it needs to be verified that it's
+ * still valid in the tree.
  */
 struct zswap_pool {
 	struct zpool *zpool;
@@ -179,14 +199,12 @@ struct zswap_pool {
  * This structure contains the metadata for tracking a single compressed
  * page within zswap.
  *
- * rbnode - links the entry into red-black tree for the appropriate swap type
- * offset - the swap offset for the entry.  Index into the red-black tree.
+ * swpentry - associated swap entry, the offset indexes into the xarray
  * refcount - the number of outstanding reference to the entry. This is needed
  *            to protect against premature freeing of the entry by code
- *            concurrent calls to load, invalidate, and writeback.  The lock
- *            for the zswap_tree structure that contains the entry must
- *            be held while changing the refcount.  Since the lock must
- *            be held, there is no reason to also make refcount atomic.
+ *            concurrent calls to load, invalidate, and writeback.  The tree
+ *            holds one reference for as long as the entry is stored in it;
+ *            lookups pin the entry with atomic_inc_not_zero() under RCU.
  * length - the length in bytes of the compressed page data.  Needed during
  *          decompression. For a same value filled page length is 0, and both
  *          pool and lru are invalid and must be ignored.
@@ -196,9 +214,8 @@ struct zswap_pool {
  * lru - handle to the pool's lru used to evict pages.
  */
 struct zswap_entry {
-	struct rb_node rbnode;
 	swp_entry_t swpentry;
-	int refcount;
+	atomic_t refcount;
 	unsigned int length;
 	struct zswap_pool *pool;
 	union {
@@ -210,16 +227,18 @@ struct zswap_entry {
 };
 
 /*
- * The tree lock in the zswap_tree struct protects a few things:
- * - the rbtree
- * - the refcount field of each entry in the tree
+ * Each swap device is split into trees of SWAP_ADDRESS_SPACE_PAGES slots,
+ * mirroring the swap cache address spaces, so that concurrent stores and
+ * loads on different parts of the device don't contend on a single lock.
+ * The xarray serializes its own modifications; lookups are lockless and
+ * rely on the entry cache being SLAB_TYPESAFE_BY_RCU.
  */
 struct zswap_tree {
-	struct rb_root rbroot;
-	spinlock_t lock;
+	struct xarray xa;
 };
 
 static struct zswap_tree *zswap_trees[MAX_SWAPFILES];
+static unsigned int nr_zswap_trees[MAX_SWAPFILES];
 
 /* RCU-protected iteration */
 static LIST_HEAD(zswap_pools);
@@ -255,6 +274,12 @@ static int zswap_writeback_entry(struct zswap_entry *entry,
 static int zswap_pool_get(struct zswap_pool *pool);
 static void zswap_pool_put(struct zswap_pool *pool);
 
+static inline struct zswap_tree *swap_zswap_tree(swp_entry_t swp)
+{
+	return &zswap_trees[swp_type(swp)][swp_offset(swp)
+		>> SWAP_ADDRESS_SPACE_SHIFT];
+}
+
 static bool zswap_is_full(void)
 {
 	return totalram_pages() * zswap_max_pool_percent / 100 <
@@ -325,8 +350,12 @@ static struct zswap_entry *zswap_entry_cache_alloc(gfp_t gfp, int nid)
 	entry = kmem_cache_alloc_node(zswap_entry_cache, gfp, nid);
 	if (!entry)
 		return NULL;
-	entry->refcount = 1;
-	RB_CLEAR_NODE(&entry->rbnode);
+	/*
+	 * Lookups may still hold a stale pointer to this object, keep them
+	 * from pinning it until it is about to be published, see
+	 * zswap_entry_find_get().
+	 */
+	atomic_set(&entry->refcount, 0);
 	return entry;
 }
 
@@ -391,64 +420,34 @@ static void zswap_lru_putback(struct list_lru *list_lru,
 }
 
 /*********************************
-* rbtree functions
+* xarray functions
 **********************************/
-static struct zswap_entry *zswap_rb_search(struct rb_root *root, pgoff_t offset)
-{
-	struct rb_node *node = root->rb_node;
-	struct zswap_entry *entry;
-	pgoff_t entry_offset;
-
-	while (node) {
-		entry = rb_entry(node, struct zswap_entry, rbnode);
-		entry_offset = swp_offset(entry->swpentry);
-		if (entry_offset > offset)
-			node = node->rb_left;
-		else if (entry_offset < offset)
-			node = node->rb_right;
-		else
-			return entry;
-	}
-	return NULL;
-}
-
 /*
- * In the case that a entry with the same offset is found, a pointer to
- * the existing entry is stored in dupentry and the function returns -EEXIST
+ * In the case that a entry with the same offset is found, the existing
+ * entry is replaced and returned in dupentry; the tree's reference on it
+ * is now owned by the caller.
  */
-static int zswap_rb_insert(struct rb_root *root, struct zswap_entry *entry,
-			struct zswap_entry **dupentry)
+static int zswap_xa_insert(struct zswap_tree *tree, struct zswap_entry *entry,
+			   struct zswap_entry **dupentry)
 {
-	struct rb_node **link = &root->rb_node, *parent = NULL;
-	struct zswap_entry *myentry;
-	pgoff_t myentry_offset, entry_offset = swp_offset(entry->swpentry);
-
-	while (*link) {
-		parent = *link;
-		myentry = rb_entry(parent, struct zswap_entry, rbnode);
-		myentry_offset = swp_offset(myentry->swpentry);
-		if (myentry_offset > entry_offset)
-			link = &(*link)->rb_left;
-		else if (myentry_offset < entry_offset)
-			link = &(*link)->rb_right;
-		else {
-			*dupentry = myentry;
-			return -EEXIST;
-		}
-	}
-	rb_link_node(&entry->rbnode, parent, link);
-	rb_insert_color(&entry->rbnode, root);
-	return 0;
+	struct zswap_entry *old;
+
+	old = xa_store(&tree->xa, swp_offset(entry->swpentry), entry,
+		       GFP_KERNEL);
+	if (xa_is_err(old))
+		return xa_err(old);
+	*dupentry = old;
+	return old ? -EEXIST : 0;
 }
 
-static bool zswap_rb_erase(struct rb_root *root, struct zswap_entry *entry)
+/*
+ * Remove @entry from the tree, if it is still there.  Returns true if the
+ * caller now owns the tree's reference on the entry.
+ */
+static bool zswap_xa_erase(struct zswap_tree *tree, struct zswap_entry *entry)
 {
-	if (!RB_EMPTY_NODE(&entry->rbnode)) {
-		rb_erase(&entry->rbnode, root);
-		RB_CLEAR_NODE(&entry->rbnode);
-		return true;
-	}
-	return false;
+	return xa_cmpxchg(&tree->xa, swp_offset(entry->swpentry), entry, NULL,
+			  0) == entry;
 }
 
 /*
@@ -473,36 +472,41 @@ static void zswap_free_entry(struct zswap_entry *entry)
 	zswap_update_total_size();
 }
 
-/* caller must hold the tree lock */
-static void zswap_entry_get(struct zswap_entry *entry)
-{
-	entry->refcount++;
-}
-
-/* caller must hold the tree lock
-* remove from the tree and free it, if nobody reference the entry
-*/
-static void zswap_entry_put(struct zswap_tree *tree,
-			struct zswap_entry *entry)
+/*
+ * Drop a reference and free the entry if it was the last one.  The tree's
+ * own reference is only dropped after the entry has been erased from it.
+ */
+static void zswap_entry_put(struct zswap_entry *entry)
 {
-	int refcount = --entry->refcount;
+	int refcount = atomic_dec_return(&entry->refcount);
 
 	WARN_ON_ONCE(refcount < 0);
-	if (refcount == 0) {
-		WARN_ON_ONCE(!RB_EMPTY_NODE(&entry->rbnode));
+	if (refcount == 0)
 		zswap_free_entry(entry);
-	}
 }
 
-/* caller must hold the tree lock */
-static struct zswap_entry *zswap_entry_find_get(struct rb_root *root,
+/*
+ * Look up the entry at @offset and pin it.  The entry cache is
+ * SLAB_TYPESAFE_BY_RCU, so an entry may be freed and reused between the
+ * lookup and the refcount increment; recheck the slot once it is pinned.
+ */
+static struct zswap_entry *zswap_entry_find_get(struct zswap_tree *tree,
 				pgoff_t offset)
 {
 	struct zswap_entry *entry;
 
-	entry = zswap_rb_search(root, offset);
-	if (entry)
-		zswap_entry_get(entry);
+	rcu_read_lock();
+repeat:
+	entry = xa_load(&tree->xa, offset);
+	if (entry) {
+		if (!atomic_inc_not_zero(&entry->refcount))
+			goto repeat;
+		if (unlikely(entry != xa_load(&tree->xa, offset))) {
+			zswap_entry_put(entry);
+			goto repeat;
+		}
+	}
+	rcu_read_unlock();
 
 	return entry;
 }
@@ -510,7 +514,7 @@ static struct zswap_entry *zswap_entry_find_get(struct rb_root *root,
 /*********************************
 * per-cpu code
 **********************************/
-static DEFINE_PER_CPU(u8 *, zswap_dstmem);
+static DEFINE_PER_CPU(u8 *[ZSWAP_MAX_BATCH_SIZE], zswap_dstmem);
 /*
  * If users dynamically change the zpool type and compressor at runtime, i.e.
  * zswap is running, zswap can have more than one zpool on one cpu, but they
@@ -518,39 +522,46 @@ static DEFINE_PER_CPU(u8 *, zswap_dstmem);
  */
 static DEFINE_PER_CPU(struct mutex *, zswap_mutex);
 
+static int zswap_dstmem_dead(unsigned int cpu);
+
 static int zswap_dstmem_prepare(unsigned int cpu)
 {
 	struct mutex *mutex;
+	unsigned int i;
 	u8 *dst;
 
-	dst = kmalloc_node(PAGE_SIZE * 2, GFP_KERNEL, cpu_to_node(cpu));
-	if (!dst)
-		return -ENOMEM;
+	for (i = 0; i < ZSWAP_MAX_BATCH_SIZE; i++) {
+		dst = kmalloc_node(PAGE_SIZE * 2, GFP_KERNEL, cpu_to_node(cpu));
+		if (!dst)
+			goto fail;
+		per_cpu(zswap_dstmem, cpu)[i] = dst;
+	}
 
 	mutex = kmalloc_node(sizeof(*mutex), GFP_KERNEL, cpu_to_node(cpu));
-	if (!mutex) {
-		kfree(dst);
-		return -ENOMEM;
-	}
+	if (!mutex)
+		goto fail;
 
 	mutex_init(mutex);
-	per_cpu(zswap_dstmem, cpu) = dst;
 	per_cpu(zswap_mutex, cpu) = mutex;
 	return 0;
+fail:
+	zswap_dstmem_dead(cpu);
+	return -ENOMEM;
 }
 
 static int zswap_dstmem_dead(unsigned int cpu)
 {
 	struct mutex *mutex;
-	u8 *dst;
+	unsigned int i;
 
 	mutex = per_cpu(zswap_mutex, cpu);
 	kfree(mutex);
 	per_cpu(zswap_mutex, cpu) = NULL;
 
-	dst = per_cpu(zswap_dstmem, cpu);
-	kfree(dst);
-	per_cpu(zswap_dstmem, cpu) = NULL;
+	for (i = 0; i < ZSWAP_MAX_BATCH_SIZE; i++) {
+		kfree(per_cpu(zswap_dstmem, cpu)[i]);
+		per_cpu(zswap_dstmem, cpu)[i] = NULL;
+	}
 
 	return 0;
 }
@@ -561,6 +572,7 @@ static int zswap_cpu_comp_prepare(unsigned int cpu, struct hlist_node *node)
 	struct crypto_acomp_ctx *acomp_ctx = per_cpu_ptr(pool->acomp_ctx, cpu);
 	struct crypto_acomp *acomp;
 	struct acomp_req *req;
+	unsigned int i;
 
 	acomp = crypto_alloc_acomp_node(pool->tfm_name, 0, 0, cpu_to_node(cpu));
 	if (IS_ERR(acomp)) {
@@ -570,23 +582,30 @@ static int zswap_cpu_comp_prepare(unsigned int cpu, struct hlist_node *node)
 	}
 	acomp_ctx->acomp = acomp;
 
-	req = acomp_request_alloc(acomp_ctx->acomp);
-	if (!req) {
-		pr_err("could not alloc crypto acomp_request %s\n",
-		       pool->tfm_name);
-		crypto_free_acomp(acomp_ctx->acomp);
-		return -ENOMEM;
-	}
-	acomp_ctx->req = req;
+	for (i = 0; i < ZSWAP_MAX_BATCH_SIZE; i++) {
+		req = acomp_request_alloc(acomp_ctx->acomp);
+		if (!req) {
+			pr_err("could not alloc crypto acomp_request %s\n",
+			       pool->tfm_name);
+			while (i--) {
+				acomp_request_free(acomp_ctx->reqs[i]);
+				acomp_ctx->reqs[i] = NULL;
+			}
+			crypto_free_acomp(acomp_ctx->acomp);
+			return -ENOMEM;
+		}
+		acomp_ctx->reqs[i] = req;
 
-	crypto_init_wait(&acomp_ctx->wait);
-	/*
-	 * if the backend of acomp is async zip, crypto_req_done() will wakeup
-	 * crypto_wait_req(); if the backend of acomp is scomp, the callback
-	 * won't be called, crypto_wait_req() will return without blocking.
-	 */
-	acomp_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
-				   crypto_req_done, &acomp_ctx->wait);
+		crypto_init_wait(&acomp_ctx->waits[i]);
+		/*
+		 * if the backend of acomp is async zip, crypto_req_done() will
+		 * wakeup crypto_wait_req(); if the backend of acomp is scomp,
+		 * the callback won't be called, crypto_wait_req() will return
+		 * without blocking.
+		 */
+		acomp_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					   crypto_req_done, &acomp_ctx->waits[i]);
+	}
 
 	acomp_ctx->mutex = per_cpu(zswap_mutex, cpu);
 	acomp_ctx->dstmem = per_cpu(zswap_dstmem, cpu);
@@ -598,10 +617,14 @@ static int zswap_cpu_comp_dead(unsigned int cpu, struct hlist_node *node)
 {
 	struct zswap_pool *pool = hlist_entry(node, struct zswap_pool, node);
 	struct crypto_acomp_ctx *acomp_ctx = per_cpu_ptr(pool->acomp_ctx, cpu);
+	unsigned int i;
 
 	if (!IS_ERR_OR_NULL(acomp_ctx)) {
-		if (!IS_ERR_OR_NULL(acomp_ctx->req))
-			acomp_request_free(acomp_ctx->req);
+		for (i = 0; i < ZSWAP_MAX_BATCH_SIZE; i++) {
+			if (!IS_ERR_OR_NULL(acomp_ctx->reqs[i]))
+				acomp_request_free(acomp_ctx->reqs[i]);
+			acomp_ctx->reqs[i] = NULL;
+		}
 		if (!IS_ERR_OR_NULL(acomp_ctx->acomp))
 			crypto_free_acomp(acomp_ctx->acomp);
 	}
@@ -693,14 +716,15 @@ static struct zswap_pool *zswap_pool_find_get(char *type, char *compressor)
 static void zswap_invalidate_entry(struct zswap_tree *tree,
 				   struct zswap_entry *entry)
 {
-	if (zswap_rb_erase(&tree->rbroot, entry))
-		zswap_entry_put(tree, entry);
+	if (zswap_xa_erase(tree, entry))
+		zswap_entry_put(entry);
 }
 
 static enum lru_status shrink_memcg_cb(struct list_head *item, struct list_lru_one *l,
 				       spinlock_t *lock, void *arg)
 {
 	struct zswap_entry *entry = container_of(item, struct zswap_entry, lru);
+	struct zswap_entry *found;
 	struct zswap_tree *tree;
 	pgoff_t swpoffset;
 	enum lru_status ret = LRU_REMOVED_RETRY;
@@ -712,7 +736,7 @@ static enum lru_status shrink_memcg_cb(struct list_head *item, struct list_lru_o
 	 * until the entry is verified to still be alive in the tree.
 	 */
 	swpoffset = swp_offset(entry->swpentry);
-	tree = zswap_trees[swp_type(entry->swpentry)];
+	tree = swap_zswap_tree(entry->swpentry);
 	list_lru_isolate(l, item);
 	/*
 	 * It's safe to drop the lock here because we return either
@@ -720,18 +744,19 @@ static enum lru_status shrink_memcg_cb(struct list_head *item, struct list_lru_o
 	 */
 	spin_unlock(lock);
 
-	/* Check for invalidate() race */
-	spin_lock(&tree->lock);
-	if (entry != zswap_rb_search(&tree->rbroot, swpoffset))
+	/*
+	 * Check for invalidate() race, and hold a reference to prevent a
+	 * free during writeback.
+	 */
+	found = zswap_entry_find_get(tree, swpoffset);
+	if (found != entry) {
+		if (found)
+			zswap_entry_put(found);
 		goto unlock;
-
-	/* Hold a reference to prevent a free during writeback */
-	zswap_entry_get(entry);
-	spin_unlock(&tree->lock);
+	}
 
 	writeback_result = zswap_writeback_entry(entry, tree);
 
-	spin_lock(&tree->lock);
 	if (writeback_result) {
 		zswap_reject_reclaim_fail++;
 		zswap_lru_putback(&entry->pool->list_lru, entry);
@@ -747,15 +772,14 @@ static enum lru_status shrink_memcg_cb(struct list_head *item, struct list_lru_o
 	/*
 	 * Writeback started successfully, the page now belongs to the
 	 * swapcache. Drop the entry from zswap - unless invalidate already
-	 * took it out while we had the tree->lock released for IO.
+	 * took it out while we were doing IO.
 	 */
 	zswap_invalidate_entry(tree, entry);
 
 put_unlock:
 	/* Drop local reference */
-	zswap_entry_put(tree, entry);
+	zswap_entry_put(entry);
 unlock:
-	spin_unlock(&tree->lock);
 	spin_lock(lock);
 	return ret;
 }
@@ -1232,14 +1256,11 @@ static int zswap_writeback_entry(struct zswap_entry *entry,
 	 * backs (our zswap_entry reference doesn't prevent that), to
 	 * avoid overwriting a new swap page with old compressed data.
 	 */
-	spin_lock(&tree->lock);
-	if (zswap_rb_search(&tree->rbroot, swp_offset(entry->swpentry)) != entry) {
-		spin_unlock(&tree->lock);
+	if (xa_load(&tree->xa, swp_offset(entry->swpentry)) != entry) {
 		delete_from_swap_cache(page_folio(page));
 		ret = -ENOMEM;
 		goto fail;
 	}
-	spin_unlock(&tree->lock);
 
 	/* decompress */
 	acomp_ctx = raw_cpu_ptr(entry->pool->acomp_ctx);
@@ -1256,9 +1277,9 @@ static int zswap_writeback_entry(struct zswap_entry *entry,
 	sg_init_one(&input, src, entry->length);
 	sg_init_table(&output, 1);
 	sg_set_page(&output, page, PAGE_SIZE, 0);
-	acomp_request_set_params(acomp_ctx->req, &input, &output, entry->length, dlen);
-	ret = crypto_wait_req(crypto_acomp_decompress(acomp_ctx->req), &acomp_ctx->wait);
-	dlen = acomp_ctx->req->dlen;
+	acomp_request_set_params(acomp_ctx->reqs[0], &input, &output, entry->length, dlen);
+	ret = crypto_wait_req(crypto_acomp_decompress(acomp_ctx->reqs[0]), &acomp_ctx->waits[0]);
+	dlen = acomp_ctx->reqs[0]->dlen;
 	mutex_unlock(acomp_ctx->mutex);
 
 	if (!zpool_can_sleep_mapped(pool))
@@ -1323,34 +1344,231 @@ static void zswap_fill_page(void *ptr, unsigned long value)
 	memset_l(page, value, PAGE_SIZE / sizeof(unsigned long));
 }
 
+/*
+ * Compress up to ZSWAP_MAX_BATCH_SIZE pages of @folio starting at @index.
+ * All requests are submitted to the acomp instance before waiting for any
+ * of them, so that an asynchronous compressor can work on the whole batch
+ * in parallel; a synchronous one simply runs them back to back.  Pages for
+ * which @same_filled is set are skipped.  On return dlens[i] holds the
+ * compressed length of page i, or a negative error.
+ */
+static void zswap_compress_batch(struct crypto_acomp_ctx *acomp_ctx,
+				 struct folio *folio, long index,
+				 unsigned int nr, const bool *same_filled,
+				 int *dlens)
+{
+	struct scatterlist inputs[ZSWAP_MAX_BATCH_SIZE];
+	struct scatterlist outputs[ZSWAP_MAX_BATCH_SIZE];
+	unsigned int i, nr_compressed = 0;
+	u64 start = ktime_get_ns();
+
+	for (i = 0; i < nr; i++) {
+		if (same_filled[i])
+			continue;
+
+		sg_init_table(&inputs[i], 1);
+		sg_set_page(&inputs[i], folio_page(folio, index + i), PAGE_SIZE, 0);
+
+		/* zswap_dstmem is of size (PAGE_SIZE * 2). Reflect same in sg_list */
+		sg_init_one(&outputs[i], acomp_ctx->dstmem[i], PAGE_SIZE * 2);
+		acomp_request_set_params(acomp_ctx->reqs[i], &inputs[i],
+					 &outputs[i], PAGE_SIZE, PAGE_SIZE);
+		dlens[i] = crypto_acomp_compress(acomp_ctx->reqs[i]);
+		nr_compressed++;
+	}
+
+	for (i = 0; i < nr; i++) {
+		if (same_filled[i])
+			continue;
+
+		dlens[i] = crypto_wait_req(dlens[i], &acomp_ctx->waits[i]);
+		if (!dlens[i])
+			dlens[i] = acomp_ctx->reqs[i]->dlen;
+	}
+
+	if (nr_compressed) {
+		zswap_compress_batches++;
+		zswap_compress_batch_pages += nr_compressed;
+		zswap_compress_batch_ns += ktime_get_ns() - start;
+	}
+}
+
+/*
+ * Store a single page of the folio being swapped out, either as the
+ * same-filled @value or as the @dlen bytes of compressed data at @dst left
+ * behind by zswap_compress_batch().  The pool reference and the per-CPU
+ * acomp context are held by zswap_store() for the whole folio.
+ */
+static bool zswap_store_page(struct folio *folio, long index,
+			     struct obj_cgroup *objcg, struct zswap_pool *pool,
+			     bool same_filled, unsigned long value,
+			     const u8 *dst, int dlen)
+{
+	swp_entry_t swp = folio_swap_entry(folio);
+	swp_entry_t page_swp = swp_entry(swp_type(swp), swp_offset(swp) + index);
+	struct zswap_tree *tree = swap_zswap_tree(page_swp);
+	struct page *page = folio_page(folio, index);
+	struct zswap_entry *entry, *dupentry;
+	unsigned long handle;
+	char *buf;
+	gfp_t gfp;
+	int ret;
+
+	if (!same_filled && (!pool || dlen < 0))
+		return false;
+
+	/* allocate entry */
+	entry = zswap_entry_cache_alloc(GFP_KERNEL, page_to_nid(page));
+	if (!entry) {
+		zswap_reject_kmemcache_fail++;
+		return false;
+	}
+
+	if (same_filled) {
+		entry->swpentry = page_swp;
+		entry->length = 0;
+		entry->value = value;
+		atomic_inc(&zswap_same_filled_pages);
+		goto insert_entry;
+	}
+
+	/* store */
+	gfp = __GFP_NORETRY | __GFP_NOWARN | __GFP_KSWAPD_RECLAIM;
+	if (zpool_malloc_support_movable(pool->zpool))
+		gfp |= __GFP_HIGHMEM | __GFP_MOVABLE;
+	ret = zpool_malloc(pool->zpool, dlen, gfp, &handle);
+	if (ret == -ENOSPC) {
+		zswap_reject_compress_poor++;
+		goto freepage;
+	}
+	if (ret) {
+		zswap_reject_alloc_fail++;
+		goto freepage;
+	}
+	buf = zpool_map_handle(pool->zpool, handle, ZPOOL_MM_WO);
+	memcpy(buf, dst, dlen);
+	zpool_unmap_handle(pool->zpool, handle);
+
+	/* populate entry, which keeps its own pool reference */
+	zswap_pool_get(pool);
+	entry->pool = pool;
+	entry->swpentry = page_swp;
+	entry->handle = handle;
+	entry->length = dlen;
+
+insert_entry:
+	entry->objcg = objcg;
+	if (objcg) {
+		obj_cgroup_get(objcg);
+		obj_cgroup_charge_zswap(objcg, entry->length);
+		/* Account before objcg ref is moved to tree */
+		count_objcg_event(objcg, ZSWPOUT);
+	}
+
+	INIT_LIST_HEAD(&entry->lru);
+	atomic_inc(&zswap_stored_pages);
+
+	/* map, the tree's reference; pairs with atomic_inc_not_zero() */
+	atomic_set_release(&entry->refcount, 1);
+	ret = zswap_xa_insert(tree, entry, &dupentry);
+	if (ret == -EEXIST) {
+		/*
+		 * A duplicate entry should have been removed at the beginning
+		 * of zswap_store(). Since the swap entry should be pinned, if
+		 * a duplicate is found again here it means that something went
+		 * wrong in the swap cache.
+		 */
+		WARN_ON(1);
+		zswap_duplicate_entry++;
+		zswap_entry_put(dupentry);
+	} else if (ret) {
+		zswap_reject_alloc_fail++;
+		/* never published, only stale lookups may hold it briefly */
+		zswap_entry_put(entry);
+		return false;
+	}
+
+	/*
+	 * We finish initializing the entry while it's already in the tree.
+	 * This is safe because concurrent stores, loads and invalidations of
+	 * this swap slot are excluded by the swapcache folio lock, and
+	 * writeback is excluded by the entry not being on the lru yet.
+	 */
+	if (entry->length)
+		zswap_lru_add(&pool->list_lru, entry);
+
+	/* update stats */
+	zswap_update_total_size();
+	count_vm_event(ZSWPOUT);
+
+	return true;
+
+freepage:
+	zswap_entry_cache_free(entry);
+	return false;
+}
+
+/*
+ * Store @nr pages of @folio starting at @index, compressing them as one
+ * batch.  Returns the number of pages stored, which is less than @nr if a
+ * page could not be stored.
+ */
+static unsigned int zswap_store_pages(struct folio *folio, long index,
+				      unsigned int nr, struct obj_cgroup *objcg,
+				      struct zswap_pool *pool,
+				      struct crypto_acomp_ctx *acomp_ctx)
+{
+	unsigned long values[ZSWAP_MAX_BATCH_SIZE];
+	bool same_filled[ZSWAP_MAX_BATCH_SIZE];
+	int dlens[ZSWAP_MAX_BATCH_SIZE];
+	unsigned int i;
+	u8 *src;
+
+	for (i = 0; i < nr; i++) {
+		same_filled[i] = false;
+		values[i] = 0;
+		dlens[i] = -EINVAL;
+		if (!zswap_same_filled_pages_enabled)
+			continue;
+
+		src = kmap_atomic(folio_page(folio, index + i));
+		same_filled[i] = zswap_is_page_same_filled(src, &values[i]);
+		kunmap_atomic(src);
+	}
+
+	if (pool)
+		zswap_compress_batch(acomp_ctx, folio, index, nr, same_filled,
+				     dlens);
+
+	for (i = 0; i < nr; i++) {
+		if (!zswap_store_page(folio, index + i, objcg, pool,
+				      same_filled[i], values[i],
+				      pool ? acomp_ctx->dstmem[i] : NULL,
+				      dlens[i]))
+			break;
+	}
+
+	return i;
+}
+
 bool zswap_store(struct folio *folio)
 {
 	swp_entry_t swp = folio_swap_entry(folio);
 	int type = swp_type(swp);
 	pgoff_t offset = swp_offset(swp);
-	struct page *page = &folio->page;
-	struct zswap_tree *tree = zswap_trees[type];
-	struct zswap_entry *entry, *dupentry;
-	struct scatterlist input, output;
-	struct crypto_acomp_ctx *acomp_ctx;
+	long index, nr_pages = folio_nr_pages(folio);
+	struct crypto_acomp_ctx *acomp_ctx = NULL;
+	unsigned int batch, nr, stored;
 	struct obj_cgroup *objcg = NULL;
 	struct mem_cgroup *memcg = NULL;
-	struct zswap_pool *pool;
-	unsigned int dlen = PAGE_SIZE;
-	unsigned long handle, value;
-	char *buf;
-	u8 *src, *dst;
-	gfp_t gfp;
-	int ret;
+	struct zswap_pool *pool = NULL;
+	struct zswap_entry *dupentry;
+	bool ret = false;
 
 	VM_WARN_ON_ONCE(!folio_test_locked(folio));
 	VM_WARN_ON_ONCE(!folio_test_swapcache(folio));
 
-	/* Large folios aren't supported */
-	if (folio_test_large(folio))
-		return false;
-
-	if (!tree)
+	if (!zswap_trees[type])
 		return false;
 
 	/*
@@ -1358,13 +1576,16 @@ bool zswap_store(struct folio *folio)
 	 * it, otherwise, if the store fails the old page won't be removed from
 	 * the tree, and it might be written back overriding the new data.
 	 */
-	spin_lock(&tree->lock);
-	dupentry = zswap_rb_search(&tree->rbroot, offset);
-	if (dupentry) {
-		zswap_duplicate_entry++;
-		zswap_invalidate_entry(tree, dupentry);
+	for (index = 0; index < nr_pages; index++) {
+		swp_entry_t page_swp = swp_entry(type, offset + index);
+
+		dupentry = xa_erase(&swap_zswap_tree(page_swp)->xa,
+				    offset + index);
+		if (dupentry) {
+			zswap_duplicate_entry++;
+			zswap_entry_put(dupentry);
+		}
 	}
-	spin_unlock(&tree->lock);
 
 	if (!zswap_enabled)
 		return false;
@@ -1393,140 +1614,58 @@ bool zswap_store(struct folio *folio)
 			zswap_pool_reached_full = false;
 	}
 
-	/* allocate entry */
-	entry = zswap_entry_cache_alloc(GFP_KERNEL, page_to_nid(page));
-	if (!entry) {
-		zswap_reject_kmemcache_fail++;
-		goto reject;
-	}
-
-	if (zswap_same_filled_pages_enabled) {
-		src = kmap_atomic(page);
-		if (zswap_is_page_same_filled(src, &value)) {
-			kunmap_atomic(src);
-			entry->swpentry = swp_entry(type, offset);
-			entry->length = 0;
-			entry->value = value;
-			atomic_inc(&zswap_same_filled_pages);
-			goto insert_entry;
-		}
-		kunmap_atomic(src);
-	}
-
-	if (!zswap_non_same_filled_pages_enabled)
-		goto freepage;
-
-	/* if entry is successfully added, it keeps the reference */
-	entry->pool = zswap_pool_current_get();
-	if (!entry->pool)
-		goto freepage;
+	if (zswap_non_same_filled_pages_enabled) {
+		pool = zswap_pool_current_get();
+		if (!pool)
+			goto reject;
 
-	if (objcg) {
-		memcg = get_mem_cgroup_from_objcg(objcg);
-		if (memcg_list_lru_alloc(memcg, &entry->pool->list_lru, GFP_KERNEL)) {
+		if (objcg) {
+			memcg = get_mem_cgroup_from_objcg(objcg);
+			if (memcg_list_lru_alloc(memcg, &pool->list_lru, GFP_KERNEL)) {
+				mem_cgroup_put(memcg);
+				goto put_pool;
+			}
 			mem_cgroup_put(memcg);
-			goto put_pool;
 		}
-		mem_cgroup_put(memcg);
-	}
-
-	/* compress */
-	acomp_ctx = raw_cpu_ptr(entry->pool->acomp_ctx);
-
-	mutex_lock(acomp_ctx->mutex);
-
-	dst = acomp_ctx->dstmem;
-	sg_init_table(&input, 1);
-	sg_set_page(&input, page, PAGE_SIZE, 0);
-
-	/* zswap_dstmem is of size (PAGE_SIZE * 2). Reflect same in sg_list */
-	sg_init_one(&output, dst, PAGE_SIZE * 2);
-	acomp_request_set_params(acomp_ctx->req, &input, &output, PAGE_SIZE, dlen);
-	/*
-	 * it maybe looks a little bit silly that we send an asynchronous request,
-	 * then wait for its completion synchronously. This makes the process look
-	 * synchronous in fact.
-	 * Theoretically, acomp supports users send multiple acomp requests in one
-	 * acomp instance, then get those requests done simultaneously. but in this
-	 * case, zswap actually does store and load page by page, there is no
-	 * existing method to send the second page before the first page is done
-	 * in one thread doing zswap.
-	 * but in different threads running on different cpu, we have different
-	 * acomp instance, so multiple threads can do (de)compression in parallel.
-	 */
-	ret = crypto_wait_req(crypto_acomp_compress(acomp_ctx->req), &acomp_ctx->wait);
-	dlen = acomp_ctx->req->dlen;
-
-	if (ret)
-		goto put_dstmem;
 
-	/* store */
-	gfp = __GFP_NORETRY | __GFP_NOWARN | __GFP_KSWAPD_RECLAIM;
-	if (zpool_malloc_support_movable(entry->pool->zpool))
-		gfp |= __GFP_HIGHMEM | __GFP_MOVABLE;
-	ret = zpool_malloc(entry->pool->zpool, dlen, gfp, &handle);
-	if (ret == -ENOSPC) {
-		zswap_reject_compress_poor++;
-		goto put_dstmem;
-	}
-	if (ret) {
-		zswap_reject_alloc_fail++;
-		goto put_dstmem;
+		/* one acomp context acquisition for all the subpages */
+		acomp_ctx = raw_cpu_ptr(pool->acomp_ctx);
+		mutex_lock(acomp_ctx->mutex);
 	}
-	buf = zpool_map_handle(entry->pool->zpool, handle, ZPOOL_MM_WO);
-	memcpy(buf, dst, dlen);
-	zpool_unmap_handle(entry->pool->zpool, handle);
-	mutex_unlock(acomp_ctx->mutex);
-
-	/* populate entry */
-	entry->swpentry = swp_entry(type, offset);
-	entry->handle = handle;
-	entry->length = dlen;
 
-insert_entry:
-	entry->objcg = objcg;
-	if (objcg) {
-		obj_cgroup_charge_zswap(objcg, entry->length);
-		/* Account before objcg ref is moved to tree */
-		count_objcg_event(objcg, ZSWPOUT);
+	batch = clamp(READ_ONCE(zswap_compress_batch_size), 1U,
+		      ZSWAP_MAX_BATCH_SIZE);
+	for (index = 0; index < nr_pages; index += stored) {
+		nr = min_t(long, batch, nr_pages - index);
+		stored = zswap_store_pages(folio, index, nr, objcg, pool,
+					   acomp_ctx);
+		if (stored < nr) {
+			index += stored;
+			break;
+		}
 	}
+	ret = index == nr_pages;
+
+	if (acomp_ctx)
+		mutex_unlock(acomp_ctx->mutex);
 
-	/* map */
-	spin_lock(&tree->lock);
 	/*
-	 * A duplicate entry should have been removed at the beginning of this
-	 * function. Since the swap entry should be pinned, if a duplicate is
-	 * found again here it means that something went wrong in the swap
-	 * cache.
+	 * A large folio is either stored in full or not at all: on failure,
+	 * drop the subpages already stored so that the whole folio is written
+	 * to the swap device and nothing stale shadows it.
 	 */
-	while (zswap_rb_insert(&tree->rbroot, entry, &dupentry) == -EEXIST) {
-		WARN_ON(1);
-		zswap_duplicate_entry++;
-		zswap_invalidate_entry(tree, dupentry);
-	}
-	if (entry->length) {
-		INIT_LIST_HEAD(&entry->lru);
-		zswap_lru_add(&entry->pool->list_lru, entry);
+	if (!ret) {
+		while (index--)
+			zswap_invalidate(type, offset + index);
 	}
-	spin_unlock(&tree->lock);
 
-	/* update stats */
-	atomic_inc(&zswap_stored_pages);
-	zswap_update_total_size();
-	count_vm_event(ZSWPOUT);
-
-	return true;
-
-put_dstmem:
-	mutex_unlock(acomp_ctx->mutex);
 put_pool:
-	zswap_pool_put(entry->pool);
-freepage:
-	zswap_entry_cache_free(entry);
+	if (pool)
+		zswap_pool_put(pool);
 reject:
 	if (objcg)
 		obj_cgroup_put(objcg);
-	return false;
+	return ret;
 
 shrink:
 	pool = zswap_pool_last_get();
@@ -1535,46 +1674,23 @@ bool zswap_store(struct folio *folio)
 	goto reject;
 }
 
-bool zswap_load(struct folio *folio)
+/* Decompress the data of @entry into @page. */
+static void zswap_decompress(struct zswap_entry *entry, struct page *page)
 {
-	swp_entry_t swp = folio_swap_entry(folio);
-	int type = swp_type(swp);
-	pgoff_t offset = swp_offset(swp);
-	struct page *page = &folio->page;
-	struct zswap_tree *tree = zswap_trees[type];
-	struct zswap_entry *entry;
 	struct scatterlist input, output;
 	struct crypto_acomp_ctx *acomp_ctx;
-	u8 *src, *dst, *tmp;
+	u8 *src, *dst, *tmp = NULL;
 	unsigned int dlen;
-	bool ret;
-
-	VM_WARN_ON_ONCE(!folio_test_locked(folio));
-
-	/* find */
-	spin_lock(&tree->lock);
-	entry = zswap_entry_find_get(&tree->rbroot, offset);
-	if (!entry) {
-		spin_unlock(&tree->lock);
-		return false;
-	}
-	spin_unlock(&tree->lock);
 
 	if (!entry->length) {
 		dst = kmap_atomic(page);
 		zswap_fill_page(dst, entry->value);
 		kunmap_atomic(dst);
-		ret = true;
-		goto stats;
+		return;
 	}
 
-	if (!zpool_can_sleep_mapped(entry->pool->zpool)) {
-		tmp = kmalloc(entry->length, GFP_KERNEL);
-		if (!tmp) {
-			ret = false;
-			goto freeentry;
-		}
-	}
+	if (!zpool_can_sleep_mapped(entry->pool->zpool))
+		tmp = kmalloc(entry->length, GFP_KERNEL | __GFP_NOFAIL);
 
 	/* decompress */
 	dlen = PAGE_SIZE;
@@ -1591,8 +1707,8 @@ bool zswap_load(struct folio *folio)
 	sg_init_one(&input, src, entry->length);
 	sg_init_table(&output, 1);
 	sg_set_page(&output, page, PAGE_SIZE, 0);
-	acomp_request_set_params(acomp_ctx->req, &input, &output, entry->length, dlen);
-	if (crypto_wait_req(crypto_acomp_decompress(acomp_ctx->req), &acomp_ctx->wait))
+	acomp_request_set_params(acomp_ctx->reqs[0], &input, &output, entry->length, dlen);
+	if (crypto_wait_req(crypto_acomp_decompress(acomp_ctx->reqs[0]), &acomp_ctx->waits[0]))
 		WARN_ON(1);
 	mutex_unlock(acomp_ctx->mutex);
 
@@ -1600,74 +1716,147 @@ bool zswap_load(struct folio *folio)
 		zpool_unmap_handle(entry->pool->zpool, entry->handle);
 	else
 		kfree(tmp);
+}
 
-	ret = true;
-stats:
-	count_vm_event(ZSWPIN);
-	if (entry->objcg)
-		count_objcg_event(entry->objcg, ZSWPIN);
-freeentry:
-	spin_lock(&tree->lock);
-	if (ret && zswap_exclusive_loads_enabled) {
-		zswap_invalidate_entry(tree, entry);
-		folio_mark_dirty(folio);
-	} else if (entry->length) {
-		zswap_lru_del(&entry->pool->list_lru, entry);
-		zswap_lru_add(&entry->pool->list_lru, entry);
+/*
+ * Count how many of the @nr_pages swap slots starting at @offset have an
+ * entry in zswap.  The caller holds the swapcache folio covering them
+ * locked, which keeps the set of entries stable.
+ */
+static long zswap_present_pages(int type, pgoff_t offset, long nr_pages)
+{
+	long index, nr_present = 0;
+
+	rcu_read_lock();
+	for (index = 0; index < nr_pages; index++) {
+		swp_entry_t swp = swp_entry(type, offset + index);
+
+		if (xa_load(&swap_zswap_tree(swp)->xa, offset + index))
+			nr_present++;
 	}
-	zswap_entry_put(tree, entry);
-	spin_unlock(&tree->lock);
+	rcu_read_unlock();
 
-	return ret;
+	return nr_present;
 }
 
-void zswap_invalidate(int type, pgoff_t offset)
+/*
+ * Returns true if zswap took care of the folio: either it is now uptodate
+ * with the decompressed data, or it is only partially backed by zswap and
+ * must fail the read (it is left !uptodate, which the swapin path reports
+ * as an IO error).  Returns false if the folio should be read from the
+ * swap device.
+ */
+bool zswap_load(struct folio *folio)
 {
-	struct zswap_tree *tree = zswap_trees[type];
+	swp_entry_t swp = folio_swap_entry(folio);
+	int type = swp_type(swp);
+	pgoff_t offset = swp_offset(swp);
+	long index, nr_pages = folio_nr_pages(folio);
+	struct zswap_tree *tree;
 	struct zswap_entry *entry;
 
-	/* find */
-	spin_lock(&tree->lock);
-	entry = zswap_rb_search(&tree->rbroot, offset);
-	if (!entry) {
-		/* entry was written back */
-		spin_unlock(&tree->lock);
-		return;
+	VM_WARN_ON_ONCE(!folio_test_locked(folio));
+
+	if (!zswap_trees[type])
+		return false;
+
+	if (nr_pages > 1) {
+		long nr_present = zswap_present_pages(type, offset, nr_pages);
+
+		if (!nr_present)
+			return false;
+		/* a large folio can only be read back if zswap has all of it */
+		if (WARN_ON_ONCE(nr_present != nr_pages))
+			return true;
 	}
-	zswap_invalidate_entry(tree, entry);
-	spin_unlock(&tree->lock);
+
+	for (index = 0; index < nr_pages; index++) {
+		swp_entry_t page_swp = swp_entry(type, offset + index);
+
+		tree = swap_zswap_tree(page_swp);
+
+		/* find */
+		entry = zswap_entry_find_get(tree, offset + index);
+		if (!entry) {
+			/* only possible for the first and only page */
+			VM_WARN_ON_ONCE(nr_pages > 1);
+			return false;
+		}
+
+		zswap_decompress(entry, folio_page(folio, index));
+
+		count_vm_event(ZSWPIN);
+		if (entry->objcg)
+			count_objcg_event(entry->objcg, ZSWPIN);
+
+		if (zswap_exclusive_loads_enabled) {
+			zswap_invalidate_entry(tree, entry);
+		} else if (entry->length) {
+			zswap_lru_del(&entry->pool->list_lru, entry);
+			zswap_lru_add(&entry->pool->list_lru, entry);
+		}
+		zswap_entry_put(entry);
+	}
+
+	if (zswap_exclusive_loads_enabled)
+		folio_mark_dirty(folio);
+	folio_mark_uptodate(folio);
+
+	return true;
 }
 
-void zswap_swapon(int type)
+void zswap_invalidate(int type, pgoff_t offset)
 {
 	struct zswap_tree *tree;
+	struct zswap_entry *entry;
+
+	if (!zswap_trees[type])
+		return;
+
+	tree = swap_zswap_tree(swp_entry(type, offset));
+	entry = xa_erase(&tree->xa, offset);
+	/* a NULL entry was written back */
+	if (entry)
+		zswap_entry_put(entry);
+}
+
+void zswap_swapon(int type, unsigned long nr_pages)
+{
+	struct zswap_tree *trees;
+	unsigned int nr, i;
 
-	tree = kzalloc(sizeof(*tree), GFP_KERNEL);
-	if (!tree) {
+	nr = DIV_ROUND_UP(nr_pages, SWAP_ADDRESS_SPACE_PAGES);
+	trees = kvcalloc(nr, sizeof(*trees), GFP_KERNEL);
+	if (!trees) {
 		pr_err("alloc failed, zswap disabled for swap type %d\n", type);
 		return;
 	}
 
-	tree->rbroot = RB_ROOT;
-	spin_lock_init(&tree->lock);
-	zswap_trees[type] = tree;
+	for (i = 0; i < nr; i++)
+		xa_init(&trees[i].xa);
+
+	nr_zswap_trees[type] = nr;
+	zswap_trees[type] = trees;
 }
 
 void zswap_swapoff(int type)
 {
-	struct zswap_tree *tree = zswap_trees[type];
-	struct zswap_entry *entry, *n;
+	struct zswap_tree *trees = zswap_trees[type];
+	struct zswap_entry *entry;
+	unsigned long offset;
+	unsigned int i;
 
-	if (!tree)
+	if (!trees)
 		return;
 
-	/* walk the tree and free everything */
-	spin_lock(&tree->lock);
-	rbtree_postorder_for_each_entry_safe(entry, n, &tree->rbroot, rbnode)
-		zswap_free_entry(entry);
-	tree->rbroot = RB_ROOT;
-	spin_unlock(&tree->lock);
-	kfree(tree);
+	/* walk the trees and free everything */
+	for (i = 0; i < nr_zswap_trees[type]; i++) {
+		xa_for_each(&trees[i].xa, offset, entry)
+			zswap_free_entry(entry);
+		xa_destroy(&trees[i].xa);
+	}
+	kvfree(trees);
+	nr_zswap_trees[type] = 0;
 	zswap_trees[type] = NULL;
 }
 
@@ -1679,6 +1868,17 @@ void zswap_swapoff(int type)
 
 static struct dentry *zswap_debugfs_root;
 
+/* Pages per second spent in the compressor, averaged since boot */
+static int zswap_compress_throughput_get(void *data, u64 *val)
+{
+	u64 ns = READ_ONCE(zswap_compress_batch_ns);
+
+	*val = ns ? div64_u64(READ_ONCE(zswap_compress_batch_pages) * NSEC_PER_SEC, ns) : 0;
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(zswap_compress_throughput_fops,
+			 zswap_compress_throughput_get, NULL, "%llu\n");
+
 static int zswap_debugfs_init(void)
 {
 	if (!debugfs_initialized())
@@ -1706,6 +1906,15 @@ static int zswap_debugfs_init(void)
 				zswap_debugfs_root, &zswap_stored_pages);
 	debugfs_create_atomic_t("same_filled_pages", 0444,
 				zswap_debugfs_root, &zswap_same_filled_pages);
+	debugfs_create_u64("compress_batches", 0444,
+			   zswap_debugfs_root, &zswap_compress_batches);
+	debugfs_create_u64("compress_batch_pages", 0444,
+			   zswap_debugfs_root, &zswap_compress_batch_pages);
+	debugfs_create_u64("compress_batch_ns", 0444,
+			   zswap_debugfs_root, &zswap_compress_batch_ns);
+	debugfs_create_file_unsafe("compress_throughput", 0444,
+				   zswap_debugfs_root, NULL,
+				   &zswap_compress_throughput_fops);
 
 	return 0;
 }
@@ -1724,7 +1933,8 @@ static int zswap_setup(void)
 	struct zswap_pool *pool;
 	int ret;
 
-	zswap_entry_cache = KMEM_CACHE(zswap_entry, 0);
+	/* lockless lookups in zswap_entry_find_get() rely on this */
+	zswap_entry_cache = KMEM_CACHE(zswap_entry, SLAB_TYPESAFE_BY_RCU);
 	if (!zswap_entry_cache) {
 		pr_err("entry cache creation failed\n");
 		goto cache_fail;
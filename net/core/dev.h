@@ -45,6 +45,7 @@ extern int		netdev_unregister_timeout_secs;
 extern int		weight_p;
 extern int		dev_weight_rx_bias;
 extern int		dev_weight_tx_bias;
+extern unsigned int	sysctl_skb_defer_max;
 
 /* rtnl helpers */
 extern struct list_head net_todo_list;
@@ -11,6 +11,8 @@
 #include <linux/device.h>
 
 #include <net/page_pool/helpers.h>
+#include <net/page_pool/memory_provider.h>
+#include <net/netdev_rx_queue.h>
 #include <net/xdp.h>
 
 #include <linux/dma-direction.h>
@@ -20,6 +22,7 @@
 #include <linux/poison.h>
 #include <linux/ethtool.h>
 #include <linux/netdevice.h>
+#include <linux/rtnetlink.h>
 
 #include <trace/events/page_pool.h>
 
@@ -170,10 +173,49 @@ static void page_pool_producer_unlock(struct page_pool *pool,
 		spin_unlock_bh(&pool->ring.producer_lock);
 }
 
+static void page_pool_uninit(struct page_pool *pool);
+
+/* Pick up the memory provider bound to the RX queue the pool is for */
+static int page_pool_mp_init(struct page_pool *pool)
+{
+	const struct memory_provider_ops *ops = NULL;
+	struct net_device *netdev = pool->slow.netdev;
+	struct napi_struct *napi = pool->p.napi;
+	unsigned int i;
+	int err = 0;
+
+	if (!netdev || !napi)
+		return 0;
+
+	rcu_read_lock();
+	for (i = 0; i < netdev->real_num_rx_queues; i++) {
+		struct netdev_rx_queue *rxq = __netif_get_rx_queue(netdev, i);
+
+		if (READ_ONCE(rxq->napi) != napi)
+			continue;
+		ops = smp_load_acquire(&rxq->mp_ops);
+		if (ops)
+			pool->mp_priv = READ_ONCE(rxq->mp_priv);
+		break;
+	}
+	if (ops) {
+		/* providers hand out single pages */
+		err = pool->p.order ? -EINVAL : ops->init(pool);
+		if (!err)
+			pool->mp_ops = ops;
+		else
+			pool->mp_priv = NULL;
+	}
+	rcu_read_unlock();
+
+	return err;
+}
+
 static int page_pool_init(struct page_pool *pool,
 			  const struct page_pool_params *params)
 {
 	unsigned int ring_qsize = 1024; /* Default */
+	int err;
 
 	memcpy(&pool->p, &params->fast, sizeof(pool->p));
 	memcpy(&pool->slow, &params->slow, sizeof(pool->slow));
@@ -237,11 +279,20 @@ static int page_pool_init(struct page_pool *pool,
 	if (pool->p.flags & PP_FLAG_DMA_MAP)
 		get_device(pool->p.dev);
 
+	err = page_pool_mp_init(pool);
+	if (err) {
+		page_pool_uninit(pool);
+		return err;
+	}
+
 	return 0;
 }
 
 static void page_pool_uninit(struct page_pool *pool)
 {
+	if (pool->mp_ops)
+		pool->mp_ops->destroy(pool);
+
 	ptr_ring_cleanup(&pool->ring, NULL);
 
 	if (pool->p.flags & PP_FLAG_DMA_MAP)
@@ -448,6 +499,29 @@ static struct page *__page_pool_alloc_page_order(struct page_pool *pool,
 	return page;
 }
 
+static struct page *page_pool_mp_alloc_page(struct page_pool *pool, gfp_t gfp)
+{
+	struct page *page;
+
+	page = pool->mp_ops->alloc_page(pool, gfp);
+	if (unlikely(!page))
+		return NULL;
+
+	if ((pool->p.flags & PP_FLAG_DMA_MAP) &&
+	    unlikely(!page_pool_dma_map(pool, page))) {
+		pool->mp_ops->release_page(pool, page);
+		return NULL;
+	}
+
+	alloc_stat_inc(pool, slow);
+	page_pool_set_pp_info(pool, page);
+
+	/* Track how many pages are held 'in-flight' */
+	pool->pages_state_hold_cnt++;
+	trace_page_pool_state_hold(pool, page, pool->pages_state_hold_cnt);
+	return page;
+}
+
 /* slow path */
 noinline
 static struct page *__page_pool_alloc_pages_slow(struct page_pool *pool,
@@ -459,6 +533,9 @@ static struct page *__page_pool_alloc_pages_slow(struct page_pool *pool,
 	struct page *page;
 	int i, nr_pages;
 
+	if (pool->mp_ops)
+		return page_pool_mp_alloc_page(pool, gfp);
+
 	/* Don't support bulk alloc for high-order pages */
 	if (unlikely(pp_order))
 		return __page_pool_alloc_page_order(pool, gfp);
@@ -575,19 +652,25 @@ void __page_pool_release_page_dma(struct page_pool *pool, struct page *page)
  */
 void page_pool_return_page(struct page_pool *pool, struct page *page)
 {
+	bool mp = pool->mp_ops;
 	int count;
 
 	__page_pool_release_page_dma(pool, page);
 
 	page_pool_clear_pp_info(page);
 
+	/* Provider pages go back before the release count drops the pool */
+	if (mp)
+		pool->mp_ops->release_page(pool, page);
+
 	/* This may be the last page returned, releasing the pool, so
 	 * it is not safe to reference pool afterwards.
 	 */
 	count = atomic_inc_return_relaxed(&pool->pages_state_release_cnt);
 	trace_page_pool_state_release(pool, page, count);
 
-	put_page(page);
+	if (!mp)
+		put_page(page);
 	/* An optimization would be to call __free_pages(page, pool->p.order)
 	 * knowing page is not part of page-cache (thus avoiding a
 	 * __page_cache_release() call).
@@ -624,17 +707,33 @@ static bool page_pool_recycle_in_cache(struct page *page,
 		return false;
 	}
 
-	/* Caller MUST have verified/know (page_ref_count(page) == 1) */
+	/* Caller MUST have verified/know page_pool_page_is_reusable() */
 	pool->alloc.cache[pool->alloc.count++] = page;
 	recycle_stat_inc(pool, cached);
 	return true;
 }
 
-/* If the page refcnt == 1, this will try to recycle the page.
+/* refcnt == 1 means page_pool owns page, and can recycle it.  Pages from
+ * a memory provider are also referenced by the provider and possibly
+ * mapped to user space, so their refcnt says nothing: skb frag references
+ * and the provider handing the page out both go through pp_ref_count, see
+ * skb_pp_mp_page(), and the pool owns the page once the last of those has
+ * been dropped.
+ *
+ * page is NOT reusable when allocated when system is under
+ * some pressure. (page_is_pfmemalloc)
+ */
+static bool page_pool_page_is_reusable(struct page_pool *pool,
+				       struct page *page)
+{
+	return (pool->mp_ops || page_ref_count(page) == 1) &&
+	       !page_is_pfmemalloc(page);
+}
+
+/* If the page is reusable, this will try to recycle the page.
  * if PP_FLAG_DMA_SYNC_DEV is set, we'll try to sync the DMA area for
  * the configured size min(dma_sync_size, pool->max_len).
- * If the page refcnt != 1, then the page will be returned to memory
- * subsystem.
+ * Otherwise the page will be returned to memory subsystem.
  */
 static __always_inline struct page *
 __page_pool_put_page(struct page_pool *pool, struct page *page,
@@ -645,13 +744,8 @@ __page_pool_put_page(struct page_pool *pool, struct page *page,
 	/* This allocator is optimized for the XDP mode that uses
 	 * one-frame-per-page, but have fallbacks that act like the
 	 * regular page allocator APIs.
-	 *
-	 * refcnt == 1 means page_pool owns page, and can recycle it.
-	 *
-	 * page is NOT reusable when allocated when system is under
-	 * some pressure. (page_is_pfmemalloc)
 	 */
-	if (likely(page_ref_count(page) == 1 && !page_is_pfmemalloc(page))) {
+	if (likely(page_pool_page_is_reusable(pool, page))) {
 		/* Read barrier done in page_ref_count / READ_ONCE */
 
 		if (pool->p.flags & PP_FLAG_DMA_SYNC_DEV)
@@ -766,7 +860,7 @@ static struct page *page_pool_drain_frag(struct page_pool *pool,
 	if (likely(page_pool_unref_page(page, drain_count)))
 		return NULL;
 
-	if (page_ref_count(page) == 1 && !page_is_pfmemalloc(page)) {
+	if (page_pool_page_is_reusable(pool, page)) {
 		if (pool->p.flags & PP_FLAG_DMA_SYNC_DEV)
 			page_pool_dma_sync_for_device(pool, page, -1);
 
@@ -972,6 +1066,75 @@ void page_pool_destroy(struct page_pool *pool)
 }
 EXPORT_SYMBOL(page_pool_destroy);
 
+/**
+ * net_mp_open_rxq() - bind a memory provider to an RX queue
+ * @dev: device the queue belongs to
+ * @rxq_idx: index of the RX queue
+ * @ops: provider callbacks
+ * @priv: provider private data, available as pool->mp_priv
+ *
+ * Page pools created for the queue after this call allocate from the
+ * provider.  Pools that already exist are not affected, the driver has to
+ * recreate them, e.g. by reconfiguring its channels.
+ *
+ * Caller must hold RTNL.
+ */
+int net_mp_open_rxq(struct net_device *dev, unsigned int rxq_idx,
+		    const struct memory_provider_ops *ops, void *priv)
+{
+	struct netdev_rx_queue *rxq;
+
+	ASSERT_RTNL();
+
+	if (rxq_idx >= dev->real_num_rx_queues)
+		return -EINVAL;
+
+	rxq = __netif_get_rx_queue(dev, rxq_idx);
+	if (rxq->mp_ops)
+		return -EBUSY;
+	/* pools are matched to the queue through its NAPI instance */
+	if (!rxq->napi)
+		return -EOPNOTSUPP;
+
+	WRITE_ONCE(rxq->mp_priv, priv);
+	smp_store_release(&rxq->mp_ops, ops);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(net_mp_open_rxq);
+
+/**
+ * net_mp_close_rxq() - unbind a memory provider from an RX queue
+ * @dev: device the queue belongs to
+ * @rxq_idx: index of the RX queue
+ * @priv: provider private data passed to net_mp_open_rxq()
+ *
+ * New pools for the queue go back to the page allocator.  Pools already
+ * using the provider keep doing so until the driver destroys them, the
+ * provider learns about that through its ->destroy() callback.
+ *
+ * Caller must hold RTNL.
+ */
+void net_mp_close_rxq(struct net_device *dev, unsigned int rxq_idx,
+		      void *priv)
+{
+	struct netdev_rx_queue *rxq;
+
+	ASSERT_RTNL();
+
+	if (WARN_ON_ONCE(rxq_idx >= dev->num_rx_queues))
+		return;
+
+	rxq = __netif_get_rx_queue(dev, rxq_idx);
+	if (WARN_ON_ONCE(rxq->mp_priv != priv))
+		return;
+
+	WRITE_ONCE(rxq->mp_ops, NULL);
+	/* page_pool_mp_init() has either taken its reference or missed us */
+	synchronize_rcu();
+	WRITE_ONCE(rxq->mp_priv, NULL);
+}
+EXPORT_SYMBOL_GPL(net_mp_close_rxq);
+
 /* Caller must provide appropriate safe context, e.g. NAPI. */
 void page_pool_update_nid(struct page_pool *pool, int new_nid)
 {
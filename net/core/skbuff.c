@@ -82,6 +82,7 @@
 #include <linux/user_namespace.h>
 #include <linux/indirect_call_wrapper.h>
 
+#include "dev.h"
 #include "sock_destructor.h"
 
 struct kmem_cache *skbuff_head_cache __ro_after_init;
@@ -344,6 +345,7 @@ static inline void __finalize_skb_around(struct sk_buff *skb, void *data,
 	atomic_set(&shinfo->dataref, 1);
 
 	skb_set_kcov_handle(skb, kcov_common_handle());
+	skb->alloc_cpu = raw_smp_processor_id();
 }
 
 static inline void *__slab_build_skb(struct sk_buff *skb, void *data,
@@ -855,6 +857,13 @@ static void skb_clone_fraglist(struct sk_buff *skb)
 }
 
 #if IS_ENABLED(CONFIG_PAGE_POOL)
+/* Caller checked that @page is a page_pool page */
+bool __skb_pp_mp_page(struct page *page)
+{
+	return !!compound_head(page)->pp->mp_ops;
+}
+EXPORT_SYMBOL(__skb_pp_mp_page);
+
 bool napi_pp_put_page(struct page *page, bool napi_safe)
 {
 	bool allow_direct = false;
@@ -1327,6 +1336,67 @@ void napi_consume_skb(struct sk_buff *skb, int budget)
 }
 EXPORT_SYMBOL(napi_consume_skb);
 
+/**
+ *	skb_attempt_defer_free - free an skb on the cpu that allocated it
+ *	@skb: buffer to free, the last reference to it
+ *
+ *	Consumers running on another cpu than the one that received @skb
+ *	(e.g. tcp_recvmsg() woken on a different core) would otherwise hand
+ *	the skb head, its slab object and its page_pool pages back to
+ *	remote caches.  Instead queue @skb on the per-cpu defer list of the
+ *	allocating cpu, which frees it from net_rx_action() in its own
+ *	NAPI context.  An IPI is sent when the list reaches half of
+ *	net.core.skb_defer_max, and the skb is freed locally if the list is
+ *	full, the allocating cpu is offline or is the current one.
+ *
+ *	The socket owning @skb must have been released by the caller.
+ */
+void skb_attempt_defer_free(struct sk_buff *skb)
+{
+	int cpu = skb->alloc_cpu;
+	struct softnet_data *sd;
+	unsigned int defer_max;
+	bool kick;
+
+	if (WARN_ON_ONCE(cpu >= nr_cpu_ids) ||
+	    !cpu_online(cpu) ||
+	    cpu == raw_smp_processor_id() ||
+	    skb->destructor) {
+nodefer:
+		__kfree_skb(skb);
+		return;
+	}
+
+	sd = &per_cpu(softnet_data, cpu);
+	defer_max = READ_ONCE(sysctl_skb_defer_max);
+	if (READ_ONCE(sd->defer_count) >= defer_max) {
+		this_cpu_inc(softnet_data.defer_full);
+		goto nodefer;
+	}
+
+	/* State tied to the consumer side is released right away. */
+	skb_dst_drop(skb);
+	nf_reset_ct(skb);
+	skb_ext_reset(skb);
+
+	spin_lock_bh(&sd->defer_lock);
+	/* Send an IPI every time queue reaches half capacity. */
+	kick = sd->defer_count == (defer_max >> 1);
+	/* Paired with the READ_ONCE() few lines above */
+	WRITE_ONCE(sd->defer_count, sd->defer_count + 1);
+
+	skb->next = sd->defer_list;
+	/* Paired with READ_ONCE() in skb_defer_free_flush() */
+	WRITE_ONCE(sd->defer_list, skb);
+	spin_unlock_bh(&sd->defer_lock);
+
+	/* Make sure to trigger NET_RX_SOFTIRQ on the remote CPU
+	 * if we are unlucky enough (this seems very unlikely).
+	 */
+	if (unlikely(kick) && !cmpxchg(&sd->defer_ipi_scheduled, 0, 1))
+		smp_call_function_single_async(cpu, &sd->defer_csd);
+}
+
 /* Make sure a field is contained by headers group */
 #define CHECK_SKB_FIELD(field) \
 	BUILD_BUG_ON(offsetof(struct sk_buff, field) !=		\
@@ -1409,6 +1479,8 @@ static struct sk_buff *__skb_clone(struct sk_buff *n, struct sk_buff *skb)
 	C(head_frag);
 	C(data);
 	C(truesize);
+	/* alloc_cpu is outside the headers copied by __copy_skb_header() */
+	C(alloc_cpu);
 	refcount_set(&n->users, 1);
 
 	atomic_inc(&(skb_shinfo(skb)->dataref));
@@ -2947,9 +3019,15 @@ static bool __skb_splice_bits(struct sk_buff *skb, struct pipe_inode_info *pipe,
 	for (seg = 0; seg < skb_shinfo(skb)->nr_frags; seg++) {
 		const skb_frag_t *f = &skb_shinfo(skb)->frags[seg];
 
-		if (__splice_segment(skb_frag_page(f),
-				     skb_frag_off(f), skb_frag_size(f),
-				     offset, len, spd, false, sk, pipe))
+		struct page *page = skb_frag_page(f);
+
+		/*
+		 * A pipe only holds page references, which don't keep memory
+		 * provider pages from being reused, copy those.
+		 */
+		if (__splice_segment(page, skb_frag_off(f), skb_frag_size(f),
+				     offset, len, spd, skb_pp_mp_page(page),
+				     sk, pipe))
 			return true;
 	}
 
@@ -3556,7 +3634,7 @@ skb_zerocopy(struct sk_buff *to, struct sk_buff *from, int len, int hlen)
 			page = virt_to_head_page(from->head);
 			offset = from->data - (unsigned char *)page_address(page);
 			__skb_fill_page_desc(to, 0, page, offset, plen);
-			get_page(page);
+			skb_page_ref(page);
 			j = 1;
 			len -= plen;
 		}
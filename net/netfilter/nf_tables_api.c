@@ -2000,14 +2000,20 @@ static void nf_tables_chain_free_chain_rules(struct nft_chain *chain)
 {
 	struct nft_rule **g0 = rcu_dereference_raw(chain->rules_gen_0);
 	struct nft_rule **g1 = rcu_dereference_raw(chain->rules_gen_1);
+	struct nft_chain_prog *p0 = rcu_dereference_raw(chain->prog_gen_0);
+	struct nft_chain_prog *p1 = rcu_dereference_raw(chain->prog_gen_1);
 
-	if (g0 != g1)
+	if (g0 != g1) {
 		kvfree(g1);
+		nft_chain_prog_free(p1);
+	}
 	kvfree(g0);
+	nft_chain_prog_free(p0);
 
 	/* should be NULL either via abort or via successful commit */
 	WARN_ON_ONCE(chain->rules_next);
 	kvfree(chain->rules_next);
+	nft_chain_prog_free(chain->prog_next);
 }
 
 void nf_tables_chain_destroy(struct nft_ctx *ctx)
@@ -2253,6 +2259,7 @@ static void nft_chain_release_hook(struct nft_chain_hook *hook)
 struct nft_rules_old {
 	struct rcu_head h;
 	struct nft_rule **start;
+	struct nft_chain_prog *prog;
 };
 
 static struct nft_rule **nf_tables_chain_alloc_rules(const struct nft_chain *chain,
@@ -9241,6 +9248,9 @@ static int nf_tables_commit_chain_prepare(struct net *net, struct nft_chain *cha
 	}
 
 	chain->rules_next[i] = NULL;
+
+	/* no program is not an error, nft_do_chain() interprets the rules */
+	chain->prog_next = nft_chain_prog_build(chain->rules_next);
 	return 0;
 }
 
@@ -9256,6 +9266,8 @@ static void nf_tables_commit_chain_prepare_cancel(struct net *net)
 		    trans->msg_type == NFT_MSG_DELRULE) {
 			kvfree(chain->rules_next);
 			chain->rules_next = NULL;
+			nft_chain_prog_free(chain->prog_next);
+			chain->prog_next = NULL;
 		}
 	}
 }
@@ -9264,10 +9276,12 @@ static void __nf_tables_commit_chain_free_rules_old(struct rcu_head *h)
 {
 	struct nft_rules_old *o = container_of(h, struct nft_rules_old, h);
 
+	nft_chain_prog_free(o->prog);
 	kvfree(o->start);
 }
 
-static void nf_tables_commit_chain_free_rules_old(struct nft_rule **rules)
+static void nf_tables_commit_chain_free_rules_old(struct nft_rule **rules,
+						  struct nft_chain_prog *prog)
 {
 	struct nft_rule **r = rules;
 	struct nft_rules_old *old;
@@ -9278,12 +9292,14 @@ static void nf_tables_commit_chain_free_rules_old(struct nft_rule **rules)
 	r++;	/* rcu_head is after end marker */
 	old = (void *) r;
 	old->start = rules;
+	old->prog = prog;
 
 	call_rcu(&old->h, __nf_tables_commit_chain_free_rules_old);
 }
 
 static void nf_tables_commit_chain(struct net *net, struct nft_chain *chain)
 {
+	struct nft_chain_prog *p0, *p1;
 	struct nft_rule **g0, **g1;
 	bool next_genbit;
 
@@ -9293,6 +9309,10 @@ static void nf_tables_commit_chain(struct net *net, struct nft_chain *chain)
 				       lockdep_commit_lock_is_held(net));
 	g1 = rcu_dereference_protected(chain->rules_gen_1,
 				       lockdep_commit_lock_is_held(net));
+	p0 = rcu_dereference_protected(chain->prog_gen_0,
+				       lockdep_commit_lock_is_held(net));
+	p1 = rcu_dereference_protected(chain->prog_gen_1,
+				       lockdep_commit_lock_is_held(net));
 
 	/* No changes to this chain? */
 	if (chain->rules_next == NULL) {
@@ -9305,29 +9325,35 @@ static void nf_tables_commit_chain(struct net *net, struct nft_chain *chain)
 		 */
 		if (next_genbit) {
 			rcu_assign_pointer(chain->rules_gen_1, g0);
-			nf_tables_commit_chain_free_rules_old(g1);
+			rcu_assign_pointer(chain->prog_gen_1, p0);
+			nf_tables_commit_chain_free_rules_old(g1, p1);
 		} else {
 			rcu_assign_pointer(chain->rules_gen_0, g1);
-			nf_tables_commit_chain_free_rules_old(g0);
+			rcu_assign_pointer(chain->prog_gen_0, p1);
+			nf_tables_commit_chain_free_rules_old(g0, p0);
 		}
 
 		return;
 	}
 
-	if (next_genbit)
+	if (next_genbit) {
 		rcu_assign_pointer(chain->rules_gen_1, chain->rules_next);
-	else
+		rcu_assign_pointer(chain->prog_gen_1, chain->prog_next);
+	} else {
 		rcu_assign_pointer(chain->rules_gen_0, chain->rules_next);
+		rcu_assign_pointer(chain->prog_gen_0, chain->prog_next);
+	}
 
 	chain->rules_next = NULL;
+	chain->prog_next = NULL;
 
 	if (g0 == g1)
 		return;
 
 	if (next_genbit)
-		nf_tables_commit_chain_free_rules_old(g1);
+		nf_tables_commit_chain_free_rules_old(g1, p1);
 	else
-		nf_tables_commit_chain_free_rules_old(g0);
+		nf_tables_commit_chain_free_rules_old(g0, p0);
 }
 
 static void nft_obj_del(struct nft_object *obj)
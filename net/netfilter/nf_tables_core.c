@@ -113,16 +113,17 @@ static inline void nft_trace_verdict(struct nft_traceinfo *info,
 	}
 }
 
-static bool nft_payload_fast_eval(const struct nft_expr *expr,
-				  struct nft_regs *regs,
-				  const struct nft_pktinfo *pkt)
+/* Load @len bytes at @offset from @base into register @dreg, if linear */
+static __always_inline bool nft_payload_fast_load(const struct nft_pktinfo *pkt,
+						  struct nft_regs *regs,
+						  u8 base, u8 offset, u8 len,
+						  u8 dreg)
 {
-	const struct nft_payload *priv = nft_expr_priv(expr);
 	const struct sk_buff *skb = pkt->skb;
-	u32 *dest = &regs->data[priv->dreg];
+	u32 *dest = &regs->data[dreg];
 	unsigned char *ptr;
 
-	if (priv->base == NFT_PAYLOAD_NETWORK_HEADER)
+	if (base == NFT_PAYLOAD_NETWORK_HEADER)
 		ptr = skb_network_header(skb);
 	else {
 		if (!(pkt->flags & NFT_PKTINFO_L4PROTO))
@@ -130,21 +131,31 @@ static bool nft_payload_fast_eval(const struct nft_expr *expr,
 		ptr = skb->data + nft_thoff(pkt);
 	}
 
-	ptr += priv->offset;
+	ptr += offset;
 
-	if (unlikely(ptr + priv->len > skb_tail_pointer(skb)))
+	if (unlikely(ptr + len > skb_tail_pointer(skb)))
 		return false;
 
 	*dest = 0;
-	if (priv->len == 2)
+	if (len == 2)
 		*(u16 *)dest = *(u16 *)ptr;
-	else if (priv->len == 4)
+	else if (len == 4)
 		*(u32 *)dest = *(u32 *)ptr;
 	else
 		*(u8 *)dest = *(u8 *)ptr;
 	return true;
 }
 
+static bool nft_payload_fast_eval(const struct nft_expr *expr,
+				  struct nft_regs *regs,
+				  const struct nft_pktinfo *pkt)
+{
+	const struct nft_payload *priv = nft_expr_priv(expr);
+
+	return nft_payload_fast_load(pkt, regs, priv->base, priv->offset,
+				     priv->len, priv->dreg);
+}
+
 DEFINE_STATIC_KEY_FALSE(nft_counters_enabled);
 
 static noinline void nft_update_chain_stats(const struct nft_chain *chain,
@@ -173,6 +184,7 @@ static noinline void nft_update_chain_stats(const struct nft_chain *chain,
 struct nft_jumpstack {
 	const struct nft_chain	*chain;
 	struct nft_rule	*const *rules;
+	const struct nft_chain_prog *prog;
 };
 
 static void expr_call_ops_eval(const struct nft_expr *expr,
@@ -200,11 +212,256 @@ static void expr_call_ops_eval(const struct nft_expr *expr,
 	expr->ops->eval(expr, regs, pkt);
 }
 
+/*
+ * Compiled chains
+ *
+ * At commit time the rules of each chain generation are flattened into one
+ * array of instructions.  The expressions the interpreter special-cases
+ * (fast payload loads, fast compares, fast bitwise and immediate verdicts)
+ * are decoded into the instruction itself, a fast payload load followed by
+ * a fast compare on the same register becomes a single instruction, and
+ * a failed compare moves straight to the first instruction of the next
+ * rule.  Every other expression is called through expr_call_ops_eval(),
+ * so the program always covers the whole chain.  The interpreter is still
+ * used while tracing, and when no program could be built.
+ */
+enum nft_insn_op {
+	NFT_INSN_EXPR,
+	NFT_INSN_PAYLOAD,
+	NFT_INSN_PAYLOAD_CMP,
+	NFT_INSN_CMP,
+	NFT_INSN_BITWISE,
+	NFT_INSN_VERDICT,
+	NFT_INSN_RULE_END,
+};
+
+struct nft_insn {
+	u8			op;
+	u8			base;
+	u8			offset;
+	u8			len;
+	u8			sreg;
+	u8			dreg;
+	bool			inv;
+	u32			mask;
+	u32			data;
+	const struct nft_expr	*expr;
+};
+
+struct nft_chain_prog {
+	struct nft_rule	*const	*rules;
+	unsigned int		nr_rules;
+	unsigned int		*rule_start;
+	struct nft_insn		insns[];
+};
+
+static bool nft_insn_payload(const struct nft_insn *insn,
+			     struct nft_regs *regs,
+			     const struct nft_pktinfo *pkt)
+{
+	return nft_payload_fast_load(pkt, regs, insn->base, insn->offset,
+				     insn->len, insn->dreg);
+}
+
+/* Run @prog from rule @rules, returns the rule that set the verdict, or the
+ * NULL end marker if the end of the chain was reached.
+ */
+static struct nft_rule *const *
+nft_chain_prog_run(const struct nft_chain_prog *prog,
+		   struct nft_rule *const *rules,
+		   struct nft_regs *regs, struct nft_pktinfo *pkt)
+{
+	unsigned int idx = rules - prog->rules;
+	const struct nft_insn *insn;
+
+	if (idx >= prog->nr_rules)
+		return rules;
+
+	insn = &prog->insns[prog->rule_start[idx]];
+	for (;;) {
+		switch (insn->op) {
+		case NFT_INSN_PAYLOAD_CMP:
+			if (unlikely(!nft_insn_payload(insn, regs, pkt))) {
+				expr_call_ops_eval(insn->expr, regs, pkt);
+				if (regs->verdict.code != NFT_CONTINUE)
+					break;
+			}
+			fallthrough;
+		case NFT_INSN_CMP:
+			if (((regs->data[insn->sreg] & insn->mask) == insn->data) ^
+			    insn->inv) {
+				insn++;
+				continue;
+			}
+			regs->verdict.code = NFT_BREAK;
+			break;
+		case NFT_INSN_PAYLOAD:
+			if (likely(nft_insn_payload(insn, regs, pkt))) {
+				insn++;
+				continue;
+			}
+			expr_call_ops_eval(insn->expr, regs, pkt);
+			break;
+		case NFT_INSN_BITWISE:
+			regs->data[insn->dreg] =
+				(regs->data[insn->sreg] & insn->mask) ^ insn->data;
+			insn++;
+			continue;
+		case NFT_INSN_VERDICT: {
+			const struct nft_immediate_expr *priv;
+
+			priv = nft_expr_priv(insn->expr);
+			regs->verdict = priv->data.verdict;
+			break;
+		}
+		case NFT_INSN_EXPR:
+			expr_call_ops_eval(insn->expr, regs, pkt);
+			break;
+		case NFT_INSN_RULE_END:
+			if (++idx == prog->nr_rules)
+				return &prog->rules[idx];
+			insn++;
+			continue;
+		}
+
+		switch (regs->verdict.code) {
+		case NFT_CONTINUE:
+			insn++;
+			continue;
+		case NFT_BREAK:
+			regs->verdict.code = NFT_CONTINUE;
+			if (++idx == prog->nr_rules)
+				return &prog->rules[idx];
+			insn = &prog->insns[prog->rule_start[idx]];
+			continue;
+		}
+
+		return &prog->rules[idx];
+	}
+}
+
+static unsigned int nft_insn_compile(struct nft_insn *insns,
+				     const struct nft_rule *rule)
+{
+	const struct nft_expr *expr, *last;
+	unsigned int n = 0;
+
+	nft_rule_for_each_expr(expr, last, rule) {
+		struct nft_insn *insn = &insns[n++];
+
+		insn->expr = expr;
+
+		if (expr->ops == &nft_payload_fast_ops) {
+			const struct nft_payload *priv = nft_expr_priv(expr);
+			const struct nft_expr *next = nft_expr_next(expr);
+
+			insn->op = NFT_INSN_PAYLOAD;
+			insn->base = priv->base;
+			insn->offset = priv->offset;
+			insn->len = priv->len;
+			insn->dreg = priv->dreg;
+
+			if (next != last && next->ops == &nft_cmp_fast_ops) {
+				const struct nft_cmp_fast_expr *cmp;
+
+				cmp = nft_expr_priv(next);
+				if (cmp->sreg == priv->dreg) {
+					insn->op = NFT_INSN_PAYLOAD_CMP;
+					insn->sreg = cmp->sreg;
+					insn->mask = cmp->mask;
+					insn->data = cmp->data;
+					insn->inv = cmp->inv;
+					expr = next;
+				}
+			}
+		} else if (expr->ops == &nft_cmp_fast_ops) {
+			const struct nft_cmp_fast_expr *priv = nft_expr_priv(expr);
+
+			insn->op = NFT_INSN_CMP;
+			insn->sreg = priv->sreg;
+			insn->mask = priv->mask;
+			insn->data = priv->data;
+			insn->inv = priv->inv;
+		} else if (expr->ops == &nft_bitwise_fast_ops) {
+			const struct nft_bitwise_fast_expr *priv = nft_expr_priv(expr);
+
+			insn->op = NFT_INSN_BITWISE;
+			insn->sreg = priv->sreg;
+			insn->dreg = priv->dreg;
+			insn->mask = priv->mask;
+			insn->data = priv->xor;
+		} else if (expr->ops->eval == nft_immediate_eval &&
+			   ((const struct nft_immediate_expr *)
+			    nft_expr_priv(expr))->dreg == NFT_REG_VERDICT) {
+			insn->op = NFT_INSN_VERDICT;
+		} else {
+			insn->op = NFT_INSN_EXPR;
+		}
+	}
+
+	insns[n++].op = NFT_INSN_RULE_END;
+	return n;
+}
+
+/**
+ * nft_chain_prog_build - compile a generation of chain rules
+ * @rules: NULL terminated array of rules, as used by nft_do_chain()
+ *
+ * The program refers to the expressions of @rules, it must be released with
+ * nft_chain_prog_free() no earlier than the rules array itself.  Returns
+ * NULL for an empty chain or if memory is short, nft_do_chain() then
+ * interprets @rules directly.
+ */
+struct nft_chain_prog *nft_chain_prog_build(struct nft_rule *const *rules)
+{
+	const struct nft_expr *expr, *last;
+	unsigned int nr_rules = 0, nr_insns = 0, i, n;
+	struct nft_chain_prog *prog;
+	size_t size;
+
+	for (i = 0; rules[i]; i++) {
+		nft_rule_for_each_expr(expr, last, rules[i])
+			nr_insns++;
+		nr_insns++;	/* NFT_INSN_RULE_END */
+		nr_rules++;
+	}
+
+	if (!nr_rules)
+		return NULL;
+
+	size = struct_size(prog, insns, nr_insns);
+	if (size == SIZE_MAX ||
+	    check_add_overflow(size, array_size(nr_rules, sizeof(unsigned int)),
+			       &size))
+		return NULL;
+
+	prog = kvzalloc(size, GFP_KERNEL_ACCOUNT);
+	if (!prog)
+		return NULL;
+
+	prog->rules = rules;
+	prog->nr_rules = nr_rules;
+	prog->rule_start = (unsigned int *)&prog->insns[nr_insns];
+
+	for (i = 0, n = 0; i < nr_rules; i++) {
+		prog->rule_start[i] = n;
+		n += nft_insn_compile(&prog->insns[n], rules[i]);
+	}
+
+	return prog;
+}
+
+void nft_chain_prog_free(struct nft_chain_prog *prog)
+{
+	kvfree(prog);
+}
+
 unsigned int
 nft_do_chain(struct nft_pktinfo *pkt, void *priv)
 {
 	const struct nft_chain *chain = priv, *basechain = chain;
 	const struct net *net = nft_net(pkt);
+	const struct nft_chain_prog *prog;
 	struct nft_rule *const *rules;
 	const struct nft_rule *rule;
 	const struct nft_expr *expr, *last;
@@ -218,14 +475,25 @@ nft_do_chain(struct nft_pktinfo *pkt, void *priv)
 	if (static_branch_unlikely(&nft_trace_enabled))
 		nft_trace_init(&info, pkt, &regs.verdict, basechain);
 do_chain:
-	if (genbit)
+	if (genbit) {
 		rules = rcu_dereference(chain->rules_gen_1);
-	else
+		prog = rcu_dereference(chain->prog_gen_1);
+	} else {
 		rules = rcu_dereference(chain->rules_gen_0);
+		prog = rcu_dereference(chain->prog_gen_0);
+	}
+	if (prog && unlikely(prog->rules != rules))
+		prog = NULL;
 
 next_rule:
 	rule = *rules;
 	regs.verdict.code = NFT_CONTINUE;
+	if (prog && !static_branch_unlikely(&nft_trace_enabled)) {
+		rules = nft_chain_prog_run(prog, rules, &regs, pkt);
+		if (*rules)
+			rule = *rules;
+		goto verdict;
+	}
 	for (; *rules ; rules++) {
 		rule = *rules;
 		nft_rule_for_each_expr(expr, last, rule) {
@@ -254,6 +522,7 @@ nft_do_chain(struct nft_pktinfo *pkt, void *priv)
 		break;
 	}
 
+verdict:
 	nft_trace_verdict(&info, chain, rule, &regs);
 
 	switch (regs.verdict.code & NF_VERDICT_MASK) {
@@ -271,6 +540,7 @@ nft_do_chain(struct nft_pktinfo *pkt, void *priv)
 			return NF_DROP;
 		jumpstack[stackptr].chain = chain;
 		jumpstack[stackptr].rules = rules + 1;
+		jumpstack[stackptr].prog = prog;
 		stackptr++;
 		fallthrough;
 	case NFT_GOTO:
@@ -287,6 +557,7 @@ nft_do_chain(struct nft_pktinfo *pkt, void *priv)
 		stackptr--;
 		chain = jumpstack[stackptr].chain;
 		rules = jumpstack[stackptr].rules;
+		prog = jumpstack[stackptr].prog;
 		goto next_rule;
 	}
 
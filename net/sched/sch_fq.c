@@ -9,7 +9,8 @@
  *  If not, (router workload), we use rxhash as fallback, with 32 bits wide hash.
  *  All packets belonging to a socket are considered as a 'flow'.
  *
- *  Flows are dynamically allocated and stored in a hash table of RB trees
+ *  Flows are dynamically allocated and stored in a hash table, each bucket
+ *  being a list kept in most recently used order.
  *  They are also part of one Round Robin 'queues' (new or old flows)
  *
  *  Burst avoidance (aka pacing) capability :
@@ -19,15 +20,15 @@
  *  packets to respect rate limitation.
  *
  *  enqueue() :
- *   - lookup one RB tree (out of 1024 or more) to find the flow.
- *     If non existent flow, create it, add it to the tree.
+ *   - lookup one hash bucket (out of 1024 or more) to find the flow.
+ *     If non existent flow, create it, add it to the bucket.
  *     Add skb to the per flow list of skb (fifo).
  *   - Use a special fifo for high prio packets
  *
- *  dequeue() : serves flows in Round Robin
+ *  dequeue() : serves flows in Round Robin, a few packets at a time
  *  Note : When a flow becomes empty, we do not immediately remove it from
- *  rb trees, for performance reasons (its expected to send additional packets,
- *  or SLAB cache will reuse socket for another flow)
+ *  the hash table, for performance reasons (its expected to send additional
+ *  packets, or SLAB cache will reuse socket for another flow)
  */
 
 #include <linux/module.h>
@@ -44,6 +45,7 @@
 #include <linux/hash.h>
 #include <linux/prefetch.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 #include <net/netlink.h>
 #include <net/pkt_sched.h>
 #include <net/sock.h>
@@ -67,7 +69,7 @@ static inline struct fq_skb_cb *fq_skb_cb(struct sk_buff *skb)
  * in linear list (head,tail), otherwise are placed in a rbtree (t_root).
  */
 struct fq_flow {
-/* First cache line : used in fq_gc(), fq_enqueue(), fq_dequeue() */
+/* First cache line : used in fq_lookup(), fq_enqueue(), fq_dequeue() */
 	struct rb_root	t_root;
 	struct sk_buff	*head;		/* list of skbs for this flow : first skb */
 	union {
@@ -75,9 +77,9 @@ struct fq_flow {
 		unsigned long  age;	/* (jiffies | 1UL) when flow was emptied, for gc */
 	};
 	union {
-		struct rb_node	fq_node;	/* anchor in fq_root[] trees */
+		struct hlist_node fq_node;	/* anchor in fq_hash[] buckets */
 		/* Following field is only used for q->internal,
-		 * because q->internal is not hashed in fq_root[]
+		 * because q->internal is not hashed in fq_hash[]
 		 */
 		u64		stat_fastpath_packets;
 	};
@@ -118,9 +120,9 @@ struct fq_sched_data {
 	u64		horizon;	/* horizon in ns */
 	u32		orphan_mask;	/* mask for orphaned skb */
 	u32		low_rate_threshold;
-	struct rb_root	*fq_root;
+	struct hlist_head *fq_hash;
 	u8		rate_enable;
-	u8		fq_trees_log;
+	u8		fq_hash_log;
 	u8		horizon_drop;
 	u8		prio2band[(TC_PRIO_MAX + 1) >> 2];
 	u32		timer_slack; /* hrtimer slack in ns */
@@ -132,6 +134,7 @@ struct fq_sched_data {
 	struct fq_perband_flows band_flows[FQ_BANDS];
 
 	struct fq_flow	internal;	/* fastpath queue. */
+	struct sk_buff	*dq_batch;	/* dequeued, not yet handed out */
 	struct rb_root	delayed;	/* for rate limited flows */
 	u64		time_next_delayed_flow;
 	unsigned long	unthrottle_latency_ns;
@@ -140,6 +143,8 @@ struct fq_sched_data {
 	u32		flows;
 	u32		inactive_flows; /* Flows with no packet to send. */
 	u32		throttled_flows;
+	struct work_struct grow_work;	/* grows fq_hash, see fq_classify() */
+	struct Qdisc	*sch;
 
 	u64		stat_throttled;
 	struct qdisc_watchdog watchdog;
@@ -252,55 +257,56 @@ static bool fq_gc_candidate(const struct fq_flow *f)
 	       time_after(jiffies, f->age + FQ_GC_AGE);
 }
 
-static void fq_gc(struct fq_sched_data *q,
-		  struct rb_root *root,
-		  struct sock *sk)
+/* Largest fq_hash, either set through TCA_FQ_BUCKETS_LOG or grown */
+#define FQ_HASH_LOG_MAX ilog2(256 * 1024)
+
+/* fq_hash is grown once it holds more flows per bucket than this */
+#define FQ_BUCKET_FLOWS_MAX 4
+
+/* Find the flow of @sk in bucket @head, collecting up to FQ_GC_MAX
+ * expired flows met on the way.  A found flow is moved to the front of
+ * its bucket, so that active flows are found after few comparisons.
+ */
+static struct fq_flow *fq_lookup(struct fq_sched_data *q,
+				 struct hlist_head *head,
+				 const struct sock *sk)
 {
-	struct rb_node **p, *parent;
+	struct fq_flow *f, *found = NULL;
 	void *tofree[FQ_GC_MAX];
-	struct fq_flow *f;
-	int i, fcnt = 0;
-
-	p = &root->rb_node;
-	parent = NULL;
-	while (*p) {
-		parent = *p;
+	struct hlist_node *tmp;
+	int fcnt = 0;
 
-		f = rb_entry(parent, struct fq_flow, fq_node);
-		if (f->sk == sk)
+	hlist_for_each_entry_safe(f, tmp, head, fq_node) {
+		if (f->sk == sk) {
+			found = f;
 			break;
-
-		if (fq_gc_candidate(f)) {
+		}
+		if (fcnt < FQ_GC_MAX && fq_gc_candidate(f)) {
+			hlist_del(&f->fq_node);
 			tofree[fcnt++] = f;
-			if (fcnt == FQ_GC_MAX)
-				break;
 		}
-
-		if (f->sk > sk)
-			p = &parent->rb_right;
-		else
-			p = &parent->rb_left;
 	}
 
-	if (!fcnt)
-		return;
-
-	for (i = fcnt; i > 0; ) {
-		f = tofree[--i];
-		rb_erase(&f->fq_node, root);
+	if (fcnt) {
+		q->flows -= fcnt;
+		q->inactive_flows -= fcnt;
+		q->stat_gc_flows += fcnt;
+		kmem_cache_free_bulk(fq_flow_cachep, fcnt, tofree);
 	}
-	q->flows -= fcnt;
-	q->inactive_flows -= fcnt;
-	q->stat_gc_flows += fcnt;
 
-	kmem_cache_free_bulk(fq_flow_cachep, fcnt, tofree);
+	if (found && head->first != &found->fq_node) {
+		hlist_del(&found->fq_node);
+		hlist_add_head(&found->fq_node, head);
+	}
+	return found;
 }
 
 /* Fast path can be used if :
  * 1) Packet tstamp is in the past.
  * 2) FQ qlen == 0   OR
  *   (no flow is currently eligible for transmit,
- *    AND fast path queue has less than 8 packets)
+ *    AND fast path queue has less than 8 packets
+ *    AND no packet is waiting in the dequeue batch)
  * 3) No SO_MAX_PACING_RATE on the socket (if any).
  * 4) No @maxrate attribute on this qdisc,
  *
@@ -329,6 +335,12 @@ static bool fq_fastpath_check(const struct Qdisc *sch, struct sk_buff *skb,
 		 */
 		if (q->internal.qlen >= 8)
 			return false;
+
+		/* Packets already picked by fq_dequeue() must leave first,
+		 * they might belong to this flow.
+		 */
+		if (q->dq_batch)
+			return false;
 	}
 
 	sk = skb->sk;
@@ -346,9 +358,8 @@ static struct fq_flow *fq_classify(struct Qdisc *sch, struct sk_buff *skb,
 				   u64 now)
 {
 	struct fq_sched_data *q = qdisc_priv(sch);
-	struct rb_node **p, *parent;
 	struct sock *sk = skb->sk;
-	struct rb_root *root;
+	struct hlist_head *head;
 	struct fq_flow *f;
 
 	/* SYNACK messages are attached to a TCP_NEW_SYN_RECV request socket
@@ -390,39 +401,27 @@ static struct fq_flow *fq_classify(struct Qdisc *sch, struct sk_buff *skb,
 		return &q->internal;
 	}
 
-	root = &q->fq_root[hash_ptr(sk, q->fq_trees_log)];
-
-	fq_gc(q, root, sk);
+	head = &q->fq_hash[hash_ptr(sk, q->fq_hash_log)];
 
-	p = &root->rb_node;
-	parent = NULL;
-	while (*p) {
-		parent = *p;
-
-		f = rb_entry(parent, struct fq_flow, fq_node);
-		if (f->sk == sk) {
-			/* socket might have been reallocated, so check
-			 * if its sk_hash is the same.
-			 * It not, we need to refill credit with
-			 * initial quantum
-			 */
-			if (unlikely(skb->sk == sk &&
-				     f->socket_hash != sk->sk_hash)) {
-				f->credit = q->initial_quantum;
-				f->socket_hash = sk->sk_hash;
-				if (q->rate_enable)
-					smp_store_release(&sk->sk_pacing_status,
-							  SK_PACING_FQ);
-				if (fq_flow_is_throttled(f))
-					fq_flow_unset_throttled(q, f);
-				f->time_next_packet = 0ULL;
-			}
-			return f;
+	f = fq_lookup(q, head, sk);
+	if (f) {
+		/* socket might have been reallocated, so check
+		 * if its sk_hash is the same.
+		 * It not, we need to refill credit with
+		 * initial quantum
+		 */
+		if (unlikely(skb->sk == sk &&
+			     f->socket_hash != sk->sk_hash)) {
+			f->credit = q->initial_quantum;
+			f->socket_hash = sk->sk_hash;
+			if (q->rate_enable)
+				smp_store_release(&sk->sk_pacing_status,
+						  SK_PACING_FQ);
+			if (fq_flow_is_throttled(f))
+				fq_flow_unset_throttled(q, f);
+			f->time_next_packet = 0ULL;
 		}
-		if (f->sk > sk)
-			p = &parent->rb_right;
-		else
-			p = &parent->rb_left;
+		return f;
 	}
 
 	f = kmem_cache_zalloc(fq_flow_cachep, GFP_ATOMIC | __GFP_NOWARN);
@@ -442,11 +441,18 @@ static struct fq_flow *fq_classify(struct Qdisc *sch, struct sk_buff *skb,
 	}
 	f->credit = q->initial_quantum;
 
-	rb_link_node(&f->fq_node, parent, p);
-	rb_insert_color(&f->fq_node, root);
+	hlist_add_head(&f->fq_node, head);
 
 	q->flows++;
 	q->inactive_flows++;
+
+	/* Garbage collection only trims the chains we walk, so with many
+	 * live flows the buckets would grow without bound.  We can not
+	 * allocate a bigger fq_hash from here, let a work item do it.
+	 */
+	if (unlikely(q->flows > (FQ_BUCKET_FLOWS_MAX << q->fq_hash_log) &&
+		     q->fq_hash_log < FQ_HASH_LOG_MAX))
+		schedule_work(&q->grow_work);
 	return f;
 }
 
@@ -479,14 +485,13 @@ static void fq_erase_head(struct Qdisc *sch, struct fq_flow *flow,
 
 /* Remove one skb from flow queue.
  * This skb must be the return value of prior fq_peek().
+ * It stays accounted in sch->q.qlen until fq_dequeue() hands it out.
  */
 static void fq_dequeue_skb(struct Qdisc *sch, struct fq_flow *flow,
 			   struct sk_buff *skb)
 {
 	fq_erase_head(sch, flow, skb);
 	skb_mark_not_on_list(skb);
-	qdisc_qstats_backlog_dec(sch, skb);
-	sch->q.qlen--;
 }
 
 static void flow_queue_add(struct fq_flow *flow, struct sk_buff *skb)
@@ -626,7 +631,10 @@ static struct fq_flow_head *fq_pband_head_select(struct fq_perband_flows *pband)
 	return pband->old_flows.first ? &pband->old_flows : NULL;
 }
 
-static struct sk_buff *fq_dequeue(struct Qdisc *sch)
+/* Pick the next packet to send from the flows, NULL if none is eligible
+ * at @now.
+ */
+static struct sk_buff *fq_dequeue_flows(struct Qdisc *sch, u64 now)
 {
 	struct fq_sched_data *q = qdisc_priv(sch);
 	struct fq_perband_flows *pband;
@@ -636,20 +644,7 @@ static struct sk_buff *fq_dequeue(struct Qdisc *sch)
 	unsigned long rate;
 	int retry;
 	u32 plen;
-	u64 now;
-
-	if (!sch->q.qlen)
-		return NULL;
-
-	skb = fq_peek(&q->internal);
-	if (unlikely(skb)) {
-		q->internal.qlen--;
-		fq_dequeue_skb(sch, &q->internal, skb);
-		goto out;
-	}
 
-	now = ktime_get_ns();
-	fq_check_throttled(q, now);
 	retry = 0;
 	pband = &q->band_flows[q->band_nr];
 begin:
@@ -755,6 +750,66 @@ static struct sk_buff *fq_dequeue(struct Qdisc *sch)
 		f->time_next_packet = now + len;
 	}
 out:
+	return skb;
+}
+
+/* Max number of packets fq_dequeue() picks from the flows per clock read */
+#define FQ_DEQUEUE_BATCH 8
+
+/* Packets are handed out one at a time, but the qdisc core usually calls
+ * fq_dequeue() several times in a row under the same lock hold.  Picking a
+ * small batch from the flows at once shares one clock read and one scan of
+ * throttled flows between them.  No more packets are picked once they add
+ * up to one quantum: with the default quantum of two MTU, full sized packets
+ * are picked by pairs, smaller ones up to FQ_DEQUEUE_BATCH at a time.
+ */
+static struct sk_buff *fq_dequeue(struct Qdisc *sch)
+{
+	struct fq_sched_data *q = qdisc_priv(sch);
+	struct sk_buff *skb, *tail;
+	int budget, n;
+	u64 now;
+
+	if (!sch->q.qlen)
+		return NULL;
+
+	skb = fq_peek(&q->internal);
+	if (unlikely(skb)) {
+		q->internal.qlen--;
+		fq_dequeue_skb(sch, &q->internal, skb);
+		goto out;
+	}
+
+	skb = q->dq_batch;
+	if (skb) {
+		q->dq_batch = skb->next;
+		skb_mark_not_on_list(skb);
+		goto out;
+	}
+
+	now = ktime_get_ns();
+	fq_check_throttled(q, now);
+
+	skb = fq_dequeue_flows(sch, now);
+	if (!skb)
+		return NULL;
+
+	budget = q->quantum - qdisc_pkt_len(skb);
+	for (n = 1, tail = NULL; n < FQ_DEQUEUE_BATCH && budget > 0; n++) {
+		struct sk_buff *nskb = fq_dequeue_flows(sch, now);
+
+		if (!nskb)
+			break;
+		budget -= qdisc_pkt_len(nskb);
+		if (tail)
+			tail->next = nskb;
+		else
+			q->dq_batch = nskb;
+		tail = nskb;
+	}
+out:
+	qdisc_qstats_backlog_dec(sch, skb);
+	sch->q.qlen--;
 	qdisc_bstats_update(sch, skb);
 	return skb;
 }
@@ -778,8 +833,7 @@ static void fq_flow_purge(struct fq_flow *flow)
 static void fq_reset(struct Qdisc *sch)
 {
 	struct fq_sched_data *q = qdisc_priv(sch);
-	struct rb_root *root;
-	struct rb_node *p;
+	struct hlist_node *tmp;
 	struct fq_flow *f;
 	unsigned int idx;
 
@@ -788,14 +842,19 @@ static void fq_reset(struct Qdisc *sch)
 
 	fq_flow_purge(&q->internal);
 
-	if (!q->fq_root)
+	while (q->dq_batch) {
+		struct sk_buff *skb = q->dq_batch;
+
+		q->dq_batch = skb->next;
+		rtnl_kfree_skbs(skb, skb);
+	}
+
+	if (!q->fq_hash)
 		return;
 
-	for (idx = 0; idx < (1U << q->fq_trees_log); idx++) {
-		root = &q->fq_root[idx];
-		while ((p = rb_first(root)) != NULL) {
-			f = rb_entry(p, struct fq_flow, fq_node);
-			rb_erase(p, root);
+	for (idx = 0; idx < (1U << q->fq_hash_log); idx++) {
+		hlist_for_each_entry_safe(f, tmp, &q->fq_hash[idx], fq_node) {
+			hlist_del(&f->fq_node);
 
 			fq_flow_purge(f);
 
@@ -813,43 +872,24 @@ static void fq_reset(struct Qdisc *sch)
 }
 
 static void fq_rehash(struct fq_sched_data *q,
-		      struct rb_root *old_array, u32 old_log,
-		      struct rb_root *new_array, u32 new_log)
+		      struct hlist_head *old_array, u32 old_log,
+		      struct hlist_head *new_array, u32 new_log)
 {
-	struct rb_node *op, **np, *parent;
-	struct rb_root *oroot, *nroot;
-	struct fq_flow *of, *nf;
+	struct hlist_node *tmp;
+	struct fq_flow *of;
 	int fcnt = 0;
 	u32 idx;
 
 	for (idx = 0; idx < (1U << old_log); idx++) {
-		oroot = &old_array[idx];
-		while ((op = rb_first(oroot)) != NULL) {
-			rb_erase(op, oroot);
-			of = rb_entry(op, struct fq_flow, fq_node);
+		hlist_for_each_entry_safe(of, tmp, &old_array[idx], fq_node) {
+			hlist_del(&of->fq_node);
 			if (fq_gc_candidate(of)) {
 				fcnt++;
 				kmem_cache_free(fq_flow_cachep, of);
 				continue;
 			}
-			nroot = &new_array[hash_ptr(of->sk, new_log)];
-
-			np = &nroot->rb_node;
-			parent = NULL;
-			while (*np) {
-				parent = *np;
-
-				nf = rb_entry(parent, struct fq_flow, fq_node);
-				BUG_ON(nf->sk == of->sk);
-
-				if (nf->sk > of->sk)
-					np = &parent->rb_right;
-				else
-					np = &parent->rb_left;
-			}
-
-			rb_link_node(&of->fq_node, parent, np);
-			rb_insert_color(&of->fq_node, nroot);
+			hlist_add_head(&of->fq_node,
+				       &new_array[hash_ptr(of->sk, new_log)]);
 		}
 	}
 	q->flows -= fcnt;
@@ -865,38 +905,49 @@ static void fq_free(void *addr)
 static int fq_resize(struct Qdisc *sch, u32 log)
 {
 	struct fq_sched_data *q = qdisc_priv(sch);
-	struct rb_root *array;
-	void *old_fq_root;
+	struct hlist_head *array;
+	void *old_fq_hash;
 	u32 idx;
 
-	if (q->fq_root && log == q->fq_trees_log)
+	if (q->fq_hash && log == q->fq_hash_log)
 		return 0;
 
 	/* If XPS was setup, we can allocate memory on right NUMA node */
-	array = kvmalloc_node(sizeof(struct rb_root) << log, GFP_KERNEL | __GFP_RETRY_MAYFAIL,
+	array = kvmalloc_node(sizeof(struct hlist_head) << log, GFP_KERNEL | __GFP_RETRY_MAYFAIL,
 			      netdev_queue_numa_node_read(sch->dev_queue));
 	if (!array)
 		return -ENOMEM;
 
 	for (idx = 0; idx < (1U << log); idx++)
-		array[idx] = RB_ROOT;
+		INIT_HLIST_HEAD(&array[idx]);
 
 	sch_tree_lock(sch);
 
-	old_fq_root = q->fq_root;
-	if (old_fq_root)
-		fq_rehash(q, old_fq_root, q->fq_trees_log, array, log);
+	old_fq_hash = q->fq_hash;
+	if (old_fq_hash)
+		fq_rehash(q, old_fq_hash, q->fq_hash_log, array, log);
 
-	q->fq_root = array;
-	q->fq_trees_log = log;
+	q->fq_hash = array;
+	q->fq_hash_log = log;
 
 	sch_tree_unlock(sch);
 
-	fq_free(old_fq_root);
+	fq_free(old_fq_hash);
 
 	return 0;
 }
 
+static void fq_grow_work(struct work_struct *work)
+{
+	struct fq_sched_data *q = container_of(work, struct fq_sched_data,
+					       grow_work);
+	u32 log = order_base_2(READ_ONCE(q->flows));
+
+	log = min_t(u32, log, FQ_HASH_LOG_MAX);
+	if (log > READ_ONCE(q->fq_hash_log))
+		fq_resize(q->sch, log);
+}
+
 static const struct netlink_range_validation iq_range = {
 	.max = INT_MAX,
 };
@@ -1000,12 +1051,12 @@ static int fq_change(struct Qdisc *sch, struct nlattr *opt,
 
 	sch_tree_lock(sch);
 
-	fq_log = q->fq_trees_log;
+	fq_log = q->fq_hash_log;
 
 	if (tb[TCA_FQ_BUCKETS_LOG]) {
 		u32 nval = nla_get_u32(tb[TCA_FQ_BUCKETS_LOG]);
 
-		if (nval >= 1 && nval <= ilog2(256*1024))
+		if (nval >= 1 && nval <= FQ_HASH_LOG_MAX)
 			fq_log = nval;
 		else
 			err = -EINVAL;
@@ -1106,8 +1157,9 @@ static void fq_destroy(struct Qdisc *sch)
 {
 	struct fq_sched_data *q = qdisc_priv(sch);
 
+	cancel_work_sync(&q->grow_work);
 	fq_reset(sch);
-	fq_free(q->fq_root);
+	fq_free(q->fq_hash);
 	qdisc_watchdog_cancel(&q->watchdog);
 }
 
@@ -1117,6 +1169,9 @@ static int fq_init(struct Qdisc *sch, struct nlattr *opt,
 	struct fq_sched_data *q = qdisc_priv(sch);
 	int i, err;
 
+	q->sch			= sch;
+	INIT_WORK(&q->grow_work, fq_grow_work);
+
 	sch->limit		= 10000;
 	q->flow_plimit		= 100;
 	q->quantum		= 2 * psched_mtu(qdisc_dev(sch));
@@ -1133,8 +1188,8 @@ static int fq_init(struct Qdisc *sch, struct nlattr *opt,
 	q->band_flows[1].quantum = 3 << 16;
 	q->band_flows[2].quantum = 1 << 16;
 	q->delayed		= RB_ROOT;
-	q->fq_root		= NULL;
-	q->fq_trees_log		= ilog2(1024);
+	q->fq_hash		= NULL;
+	q->fq_hash_log		= ilog2(1024);
 	q->orphan_mask		= 1024 - 1;
 	q->low_rate_threshold	= 550000 / 8;
 
@@ -1152,7 +1207,7 @@ static int fq_init(struct Qdisc *sch, struct nlattr *opt,
 	if (opt)
 		err = fq_change(sch, opt, extack);
 	else
-		err = fq_resize(sch, q->fq_trees_log);
+		err = fq_resize(sch, q->fq_hash_log);
 
 	return err;
 }
@@ -1190,7 +1245,7 @@ static int fq_dump(struct Qdisc *sch, struct sk_buff *skb)
 	    nla_put_u32(skb, TCA_FQ_LOW_RATE_THRESHOLD,
 			q->low_rate_threshold) ||
 	    nla_put_u32(skb, TCA_FQ_CE_THRESHOLD, (u32)ce_threshold) ||
-	    nla_put_u32(skb, TCA_FQ_BUCKETS_LOG, q->fq_trees_log) ||
+	    nla_put_u32(skb, TCA_FQ_BUCKETS_LOG, q->fq_hash_log) ||
 	    nla_put_u32(skb, TCA_FQ_TIMER_SLACK, q->timer_slack) ||
 	    nla_put_u32(skb, TCA_FQ_HORIZON, (u32)horizon) ||
 	    nla_put_u8(skb, TCA_FQ_HORIZON_DROP, q->horizon_drop))
@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * zswap_stress.c - Concurrent swapout/swapin stress benchmark for zswap
+ *
+ * Each thread owns a private anonymous region which it repeatedly pushes
+ * out with MADV_PAGEOUT and faults back in, verifying the contents.  With
+ * zswap enabled every swapout is a zswap store and every fault a zswap
+ * load, so the aggregate rate scales with how well the zswap index copes
+ * with concurrent access.  Run it before and after a zswap change on the
+ * same machine and compare the pages/s figures.
+ *
+ * Usage: zswap_stress [-t threads] [-m MiB per thread] [-i iterations]
+ */
+
+#define _GNU_SOURCE
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifndef MADV_PAGEOUT
+#define MADV_PAGEOUT 21
+#endif
+
+static long page_size;
+static size_t region_size = 64UL << 20;
+static int nr_iterations = 16;
+static int nr_threads;
+
+struct worker {
+	pthread_t thread;
+	int id;
+	unsigned long pages_out;
+	unsigned long pages_in;
+	unsigned long mismatches;
+	bool pageout_unsupported;
+};
+
+static bool zswap_enabled(void)
+{
+	char buf[8] = { 0 };
+	FILE *f;
+
+	f = fopen("/sys/module/zswap/parameters/enabled", "r");
+	if (!f)
+		return false;
+	if (!fgets(buf, sizeof(buf), f))
+		buf[0] = 'N';
+	fclose(f);
+	return buf[0] == 'Y' || buf[0] == '1';
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Fill a page with moderately compressible data: a per-page header
+ * followed by a short repeating pattern, so that zswap stores it
+ * compressed rather than as a same-filled page.
+ */
+static void fill_page(char *p, int id, unsigned long idx, int iter)
+{
+	uint64_t *words = (uint64_t *)p;
+	size_t i;
+
+	for (i = 0; i < page_size / sizeof(*words); i++)
+		words[i] = ((uint64_t)id << 48) ^ (idx << 16) ^ (i & 0xff) ^ iter;
+}
+
+static bool check_page(char *p, int id, unsigned long idx, int iter)
+{
+	uint64_t *words = (uint64_t *)p;
+	size_t i;
+
+	for (i = 0; i < page_size / sizeof(*words); i++)
+		if (words[i] != (((uint64_t)id << 48) ^ (idx << 16) ^
+				 (i & 0xff) ^ iter))
+			return false;
+	return true;
+}
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	unsigned long nr_pages = region_size / page_size;
+	unsigned long idx;
+	char *region;
+	int iter;
+
+	region = mmap(NULL, region_size, PROT_READ | PROT_WRITE,
+		      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (region == MAP_FAILED)
+		err(1, "mmap");
+
+	/* Keep every page base-sized so each swapout is a single store. */
+	madvise(region, region_size, MADV_NOHUGEPAGE);
+
+	for (iter = 0; iter < nr_iterations; iter++) {
+		for (idx = 0; idx < nr_pages; idx++)
+			fill_page(region + idx * page_size, w->id, idx, iter);
+
+		if (madvise(region, region_size, MADV_PAGEOUT)) {
+			if (errno == EINVAL)
+				w->pageout_unsupported = true;
+			break;
+		}
+		w->pages_out += nr_pages;
+
+		for (idx = 0; idx < nr_pages; idx++) {
+			if (!check_page(region + idx * page_size, w->id, idx,
+					iter))
+				w->mismatches++;
+		}
+		w->pages_in += nr_pages;
+	}
+
+	munmap(region, region_size);
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long total_out = 0, total_in = 0, mismatches = 0;
+	struct worker *workers;
+	double start, elapsed;
+	int opt, i;
+
+	page_size = sysconf(_SC_PAGESIZE);
+	nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	while ((opt = getopt(argc, argv, "t:m:i:")) != -1) {
+		switch (opt) {
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		case 'm':
+			region_size = strtoul(optarg, NULL, 0) << 20;
+			break;
+		case 'i':
+			nr_iterations = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"Usage: %s [-t threads] [-m MiB] [-i iterations]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (nr_threads <= 0 || !region_size || nr_iterations <= 0)
+		errx(1, "invalid arguments");
+
+	if (!zswap_enabled()) {
+		printf("[SKIP]\tzswap is not enabled\n");
+		return 4;
+	}
+
+	workers = calloc(nr_threads, sizeof(*workers));
+	if (!workers)
+		err(1, "calloc");
+
+	start = now();
+	for (i = 0; i < nr_threads; i++) {
+		workers[i].id = i;
+		if (pthread_create(&workers[i].thread, NULL, worker_fn,
+				   &workers[i]))
+			errx(1, "pthread_create");
+	}
+	for (i = 0; i < nr_threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		if (workers[i].pageout_unsupported) {
+			printf("[SKIP]\tMADV_PAGEOUT is not supported\n");
+			return 4;
+		}
+		total_out += workers[i].pages_out;
+		total_in += workers[i].pages_in;
+		mismatches += workers[i].mismatches;
+	}
+	elapsed = now() - start;
+
+	printf("threads %d, %zu MiB/thread, %d iterations, %.2fs\n",
+	       nr_threads, region_size >> 20, nr_iterations, elapsed);
+	printf("swapout %.0f pages/s, swapin %.0f pages/s\n",
+	       total_out / elapsed, total_in / elapsed);
+
+	if (mismatches) {
+		printf("[FAIL]\t%lu pages read back with wrong contents\n",
+		       mismatches);
+		return 1;
+	}
+
+	printf("[OK]\tall pages read back intact\n");
+	return 0;
+}
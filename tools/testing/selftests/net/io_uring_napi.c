@@ -0,0 +1,327 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Exercise IORING_REGISTER_NAPI: a TCP ping-pong where both ends wait for
+ * completions with io_uring_enter(), busy polling the NAPI instance of the
+ * socket while they wait.  Meant to be run over a veth pair with GRO
+ * enabled, see io_uring_napi.sh.
+ *
+ * Usage: io_uring_napi [-4|-6] -D <addr> [-p port] [-b busy_poll_us]
+ *			[-P] [-q] [-n round trips] (-s|-c)
+ */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <error.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/io_uring.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+#ifndef IORING_REGISTER_NAPI
+#define IORING_REGISTER_NAPI	27
+#define IORING_UNREGISTER_NAPI	28
+
+struct io_uring_napi {
+	__u32	busy_poll_to;
+	__u8	prefer_busy_poll;
+	__u8	pad[3];
+	__u64	resv;
+};
+#endif
+
+#define MSG_LEN		64
+
+struct ring {
+	int fd;
+	unsigned int *sq_tail, *sq_mask, *sq_array;
+	unsigned int *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+};
+
+static int cfg_family = AF_INET;
+static int cfg_port = 8000;
+static int cfg_busy_poll_us = 50;
+static int cfg_rounds = 10000;
+static bool cfg_prefer;
+static bool cfg_sqpoll;
+static bool cfg_server;
+static struct sockaddr_storage cfg_addr;
+static socklen_t cfg_alen;
+
+static void ring_init(struct ring *r)
+{
+	struct io_uring_params p = { };
+	void *sq, *cq;
+
+	if (cfg_sqpoll) {
+		p.flags |= IORING_SETUP_SQPOLL;
+		p.sq_thread_idle = 1000;
+	}
+
+	r->fd = syscall(__NR_io_uring_setup, 8, &p);
+	if (r->fd < 0)
+		error(1, errno, "io_uring_setup");
+	if (!(p.features & IORING_FEAT_SINGLE_MMAP))
+		error(1, 0, "IORING_FEAT_SINGLE_MMAP not supported");
+
+	sq = mmap(NULL, p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe),
+		  PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd,
+		  IORING_OFF_SQ_RING);
+	if (sq == MAP_FAILED)
+		error(1, errno, "mmap sq ring");
+	cq = sq;
+
+	r->sq_tail = sq + p.sq_off.tail;
+	r->sq_mask = sq + p.sq_off.ring_mask;
+	r->sq_array = sq + p.sq_off.array;
+	r->cq_head = cq + p.cq_off.head;
+	r->cq_tail = cq + p.cq_off.tail;
+	r->cq_mask = cq + p.cq_off.ring_mask;
+	r->cqes = cq + p.cq_off.cqes;
+
+	r->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+		       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd,
+		       IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED)
+		error(1, errno, "mmap sqes");
+}
+
+static void napi_register(struct ring *r)
+{
+	struct io_uring_napi napi = {
+		.busy_poll_to = cfg_busy_poll_us,
+		.prefer_busy_poll = cfg_prefer,
+	};
+	struct io_uring_napi again = napi;
+
+	if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_NAPI,
+		    &napi, 1))
+		error(1, errno, "IORING_REGISTER_NAPI");
+
+	/* registering again must hand back the settings we just installed */
+	if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_NAPI,
+		    &again, 1))
+		error(1, errno, "IORING_REGISTER_NAPI");
+	if (again.busy_poll_to != cfg_busy_poll_us ||
+	    again.prefer_busy_poll != cfg_prefer)
+		error(1, 0, "IORING_REGISTER_NAPI returned %u/%u, want %u/%u",
+		      again.busy_poll_to, again.prefer_busy_poll,
+		      cfg_busy_poll_us, cfg_prefer);
+}
+
+static void napi_unregister(struct ring *r)
+{
+	struct io_uring_napi napi = { };
+
+	if (syscall(__NR_io_uring_register, r->fd, IORING_UNREGISTER_NAPI,
+		    &napi, 1))
+		error(1, errno, "IORING_UNREGISTER_NAPI");
+	if (napi.busy_poll_to != cfg_busy_poll_us)
+		error(1, 0, "IORING_UNREGISTER_NAPI returned %u, want %u",
+		      napi.busy_poll_to, cfg_busy_poll_us);
+}
+
+/* Issue one send or recv and wait for its completion. */
+static int ring_io(struct ring *r, int op, int fd, void *buf, size_t len)
+{
+	unsigned int tail = *r->sq_tail, head;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	unsigned int flags = IORING_ENTER_GETEVENTS;
+	int res;
+
+	sqe = &r->sqes[tail & *r->sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = op;
+	sqe->fd = fd;
+	sqe->addr = (unsigned long)buf;
+	sqe->len = len;
+	r->sq_array[tail & *r->sq_mask] = tail & *r->sq_mask;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	if (cfg_sqpoll)
+		flags |= IORING_ENTER_SQ_WAKEUP;
+	if (syscall(__NR_io_uring_enter, r->fd, cfg_sqpoll ? 0 : 1, 1, flags,
+		    NULL, 0) < 0)
+		error(1, errno, "io_uring_enter");
+
+	head = *r->cq_head;
+	while (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+		if (syscall(__NR_io_uring_enter, r->fd, 0, 1, flags, NULL,
+			    0) < 0)
+			error(1, errno, "io_uring_enter");
+	}
+	cqe = &r->cqes[head & *r->cq_mask];
+	res = cqe->res;
+	__atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+
+	if (res < 0)
+		error(1, -res, "%s", op == IORING_OP_RECV ? "recv" : "send");
+	return res;
+}
+
+static int setup_server(void)
+{
+	int fd, cfd, one = 1;
+
+	fd = socket(cfg_family, SOCK_STREAM, 0);
+	if (fd < 0)
+		error(1, errno, "socket");
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)))
+		error(1, errno, "setsockopt");
+	if (bind(fd, (void *)&cfg_addr, cfg_alen))
+		error(1, errno, "bind");
+	if (listen(fd, 1))
+		error(1, errno, "listen");
+	cfd = accept(fd, NULL, NULL);
+	if (cfd < 0)
+		error(1, errno, "accept");
+	close(fd);
+	return cfd;
+}
+
+static int setup_client(void)
+{
+	int fd, i;
+
+	fd = socket(cfg_family, SOCK_STREAM, 0);
+	if (fd < 0)
+		error(1, errno, "socket");
+	for (i = 0; i < 50; i++) {
+		if (!connect(fd, (void *)&cfg_addr, cfg_alen))
+			return fd;
+		usleep(100 * 1000);
+	}
+	error(1, errno, "connect");
+	return -1;
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void do_pingpong(void)
+{
+	char buf[MSG_LEN], msg[MSG_LEN];
+	struct ring r;
+	double start;
+	int fd, i, len;
+
+	fd = cfg_server ? setup_server() : setup_client();
+	ring_init(&r);
+	if (cfg_busy_poll_us)
+		napi_register(&r);
+
+	memset(msg, 'a', sizeof(msg));
+	start = now_us();
+	for (i = 0; i < cfg_rounds; i++) {
+		if (!cfg_server)
+			ring_io(&r, IORING_OP_SEND, fd, msg, sizeof(msg));
+		for (len = 0; len < MSG_LEN; ) {
+			int ret = ring_io(&r, IORING_OP_RECV, fd, buf + len,
+					  MSG_LEN - len);
+
+			if (!ret)
+				error(1, 0, "peer closed after %d rounds", i);
+			len += ret;
+		}
+		if (memcmp(buf, msg, sizeof(buf)))
+			error(1, 0, "data mismatch in round %d", i);
+		if (cfg_server)
+			ring_io(&r, IORING_OP_SEND, fd, buf, sizeof(buf));
+	}
+
+	if (!cfg_server)
+		fprintf(stderr, "busy_poll %dus%s%s: %d round trips, %.1f us avg\n",
+			cfg_busy_poll_us, cfg_prefer ? " prefer" : "",
+			cfg_sqpoll ? " sqpoll" : "", cfg_rounds,
+			(now_us() - start) / cfg_rounds);
+
+	if (cfg_busy_poll_us)
+		napi_unregister(&r);
+	close(fd);
+}
+
+static void parse_opts(int argc, char **argv)
+{
+	struct sockaddr_in6 *addr6 = (void *)&cfg_addr;
+	struct sockaddr_in *addr4 = (void *)&cfg_addr;
+	char *addr = NULL;
+	int c;
+
+	while ((c = getopt(argc, argv, "46D:p:b:Pqn:sc")) != -1) {
+		switch (c) {
+		case '4':
+			cfg_family = AF_INET;
+			break;
+		case '6':
+			cfg_family = AF_INET6;
+			break;
+		case 'D':
+			addr = optarg;
+			break;
+		case 'p':
+			cfg_port = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			cfg_busy_poll_us = strtoul(optarg, NULL, 0);
+			break;
+		case 'P':
+			cfg_prefer = true;
+			break;
+		case 'q':
+			cfg_sqpoll = true;
+			break;
+		case 'n':
+			cfg_rounds = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			cfg_server = true;
+			break;
+		case 'c':
+			cfg_server = false;
+			break;
+		default:
+			error(1, 0, "Usage: %s [-4|-6] -D <addr> [-p port] "
+			      "[-b busy_poll_us] [-P] [-q] [-n rounds] (-s|-c)",
+			      argv[0]);
+		}
+	}
+
+	if (!addr)
+		error(1, 0, "-D <addr> is required");
+
+	if (cfg_family == AF_INET) {
+		addr4->sin_family = AF_INET;
+		addr4->sin_port = htons(cfg_port);
+		if (inet_pton(AF_INET, addr, &addr4->sin_addr) != 1)
+			error(1, 0, "ipv4 parse error: %s", addr);
+		cfg_alen = sizeof(*addr4);
+	} else {
+		addr6->sin6_family = AF_INET6;
+		addr6->sin6_port = htons(cfg_port);
+		if (inet_pton(AF_INET6, addr, &addr6->sin6_addr) != 1)
+			error(1, 0, "ipv6 parse error: %s", addr);
+		cfg_alen = sizeof(*addr6);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	parse_opts(argc, argv);
+	do_pingpong();
+	return 0;
+}
@@ -0,0 +1,58 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# TCP ping-pong between two namespaces over veth with io_uring NAPI busy
+# polling, without and with busy polling, prefer-busy-poll and SQPOLL.
+
+set -e
+
+readonly DEV="veth0"
+readonly BIN="./io_uring_napi"
+
+readonly RAND="$(mktemp -u XXXXXX)"
+readonly NSPREFIX="ns-${RAND}"
+readonly NS1="${NSPREFIX}1"
+readonly NS2="${NSPREFIX}2"
+
+readonly DADDR4='192.168.1.2'
+readonly DADDR6='fd::2'
+
+cleanup() {
+	ip netns del "${NS2}" 2>/dev/null || true
+	ip netns del "${NS1}" 2>/dev/null || true
+}
+
+trap cleanup EXIT
+
+ip netns add "${NS1}"
+ip netns add "${NS2}"
+
+ip link add "${DEV}" netns "${NS1}" type veth peer name "${DEV}" netns "${NS2}"
+
+# GRO makes veth run its receive path from a NAPI instance
+for ns in "${NS1}" "${NS2}"; do
+	ip netns exec "${ns}" ethtool -K "${DEV}" gro on >/dev/null
+	ip -netns "${ns}" link set "${DEV}" up
+done
+
+ip -netns "${NS1}" addr add 192.168.1.1/24 dev "${DEV}"
+ip -netns "${NS2}" addr add 192.168.1.2/24 dev "${DEV}"
+ip -netns "${NS1}" addr add       fd::1/64 dev "${DEV}" nodad
+ip -netns "${NS2}" addr add       fd::2/64 dev "${DEV}" nodad
+
+do_test() {
+	local -r ip="$1"
+	local -r daddr="$2"
+	shift 2
+
+	ip netns exec "${NS2}" "${BIN}" "-${ip}" -D "${daddr}" -n 2000 "$@" -s &
+	ip netns exec "${NS1}" "${BIN}" "-${ip}" -D "${daddr}" -n 2000 "$@" -c
+	wait $!
+}
+
+for args in "-b 0" "-b 50" "-b 50 -P" "-b 50 -q"; do
+	do_test 4 "${DADDR4}" ${args}
+	do_test 6 "${DADDR6}" ${args}
+done
+
+echo "OK. All tests passed"